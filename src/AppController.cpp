@@ -8,10 +8,8 @@ AppController::AppController()
     dataManager.addSensor("sensor_1"); // for testing
     dataManager.addSensor("sensor_2"); // for testing
 
-    // Add the sensors from the InfluxDB
-    dataManager.setInfluxDBSensors();
-
-    // Start background updates on the DataManager
+    // Start background updates on the DataManager. The sensor catalogue starts from its local cache
+    // and picks up new sensors from the InfluxDB in the background
     dataManager.startBackgroundUpdates();
 
     // Update the plottable sensors in the viewModel from the dataManager buffers
@@ -19,8 +17,19 @@ AppController::AppController()
 
     // Set the callback for when the view range changes in the graphView
     graphView.setUpdateRangeCallback(
-        [this](const std::string& sensor_id, int plot_id, double start, double end) {
-            dataManager.setSensorRange(sensor_id, plot_id, start, end);
+        [this](SensorHandle sensor, int plot_id, SensorTimestamp start, SensorTimestamp end) {
+            dataManager.setSensorRange(sensor, plot_id, start, end);
+        });
+
+    // Spectrogram plots share the DataManager's tile cache and report their range to it
+    viewModel.setSpectrogramCache(dataManager.getSpectrogramCache());
+    graphView.setSpectrogramRangeCallback(
+        [this](int plot_id, double start, double end, int pixel_width) {
+            dataManager.setSpectrogramRange(plot_id, start, end, pixel_width);
+        });
+    graphView.setSpectrogramRemovedCallback(
+        [this](int plot_id) {
+            dataManager.removeSpectrogramPlot(plot_id);
         });
 
     // Start the update viewModel thread
@@ -39,17 +48,20 @@ AppController::~AppController() {
 
 // Update the plottable sensors in the viewModel from the dataManager buffers
 void AppController::updatePlottableSensors() {
-    std::vector<std::string> sensor_names;
-    for (const auto& [sensor_id, _] : dataManager.getBuffers()) {
-        sensor_names.push_back(sensor_id);
-    }
-    viewModel.setPlottableSensors(sensor_names);
+    plottable_catalogue_ = dataManager.getSensorCatalogue();
+    viewModel.setPlottableSensors(plottable_catalogue_->getLabels());
 
 }
 
 // Update the viewModel with data from the dataManager in a separate thread
 void AppController::updateViewModel() {
     while (!stop_update_viewModel_thread_) {
+        // Publish sensors added by the background catalogue refresh
+        if (dataManager.getSensorCatalogue() != plottable_catalogue_) {
+            std::lock_guard<std::mutex> lock(update_viewModel_mutex_);
+            updatePlottableSensors();
+        }
+
         viewModel.updatePlotsWithData(dataManager);
         std::this_thread::sleep_for(std::chrono::seconds(1)); // Update every second
     }
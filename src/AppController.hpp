@@ -21,6 +21,8 @@ private:
     GraphViewModel viewModel;
     GraphView graphView;
 
+    std::shared_ptr<const SensorCatalogue> plottable_catalogue_; // Catalogue the plottable sensors were taken from
+
     std::thread update_viewModel_thread_;
     std::mutex update_viewModel_mutex_;
     bool stop_update_viewModel_thread_;
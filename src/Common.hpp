@@ -23,6 +23,8 @@
 #include <thread>
 #include <chrono>
 #include <set>
+#include <memory_resource>
+#include <string_view>
 
 #include "Config.hpp"
 
@@ -1,4 +1,5 @@
 #include "Config.hpp"
+#include <cmath>
 #include <filesystem>
 
 Config::Config(const std::string& configFilePath) {
@@ -147,6 +148,47 @@ std::string Config::getToken() const {
     return configMap.at("TOKEN");
 }
 
+std::size_t Config::getMemoryBudgetMB() const {
+    auto it = configMap.find("MEMORY_BUDGET_MB");
+    if (it == configMap.end()) {
+        return DEFAULT_MEMORY_BUDGET_MB;
+    }
+    // A malformed value falls back to the default instead of stopping the program
+    try {
+        if (it->second.find('-') == std::string::npos) {
+            return std::stoull(it->second);
+        }
+    } catch (const std::exception&) {
+    }
+    std::cerr << "Invalid MEMORY_BUDGET_MB in config file: \"" << it->second << "\", using " << DEFAULT_MEMORY_BUDGET_MB << "\n";
+    return DEFAULT_MEMORY_BUDGET_MB;
+}
+
+double Config::getPrefetchBudget() const {
+    auto it = configMap.find("PREFETCH_BUDGET");
+    if (it == configMap.end()) {
+        return DEFAULT_PREFETCH_BUDGET;
+    }
+    // A malformed value falls back to the default instead of stopping the program
+    try {
+        const double budget = std::stod(it->second);
+        if (std::isfinite(budget) && budget >= 0) {
+            return budget;
+        }
+    } catch (const std::exception&) {
+    }
+    std::cerr << "Invalid PREFETCH_BUDGET in config file: \"" << it->second << "\", using " << DEFAULT_PREFETCH_BUDGET << "\n";
+    return DEFAULT_PREFETCH_BUDGET;
+}
+
+std::string Config::getSensorCatalogueFile() const {
+    auto it = configMap.find("SENSOR_CATALOGUE_FILE");
+    if (it == configMap.end()) {
+        return DEFAULT_SENSOR_CATALOGUE_FILE;
+    }
+    return it->second;
+}
+
 void Config::debugPrintconfigMap() const {
     std::cout << "KEYS: \n";
     for (const auto& element : configMap) {
@@ -10,6 +10,10 @@
 
 class Config {
 public:
+    constexpr static std::size_t DEFAULT_MEMORY_BUDGET_MB = 1024;
+    constexpr static double DEFAULT_PREFETCH_BUDGET = 1.0;
+    constexpr static const char* DEFAULT_SENSOR_CATALOGUE_FILE = "sensor_catalogue.txt";
+
     Config(const std::string& configFilePath);
 
     std::string getDataDir() const;
@@ -25,6 +29,9 @@ public:
     std::string getPassword() const;
     std::string getPrecision() const;
     std::string getToken() const;
+    std::size_t getMemoryBudgetMB() const; // Optional, defaults to DEFAULT_MEMORY_BUDGET_MB
+    double getPrefetchBudget() const; // Optional, fraction of the plot width. Defaults to DEFAULT_PREFETCH_BUDGET
+    std::string getSensorCatalogueFile() const; // Optional, defaults to DEFAULT_SENSOR_CATALOGUE_FILE
     void debugPrintconfigMap() const;
 
 private:
@@ -1,6 +1,11 @@
 #include "DataManager.hpp"
 #include <iostream> // FOR TESTING
 #include <iomanip> // FOR TESTING
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
 
 
 // Constructor
@@ -15,162 +20,326 @@ DataManager::DataManager() : background_thread_running_(false), config_("config.
     const std::string precision = config_.getPrecision();
     const std::string token = config_.getToken();
 
-    // Initialize the InfluxDB connection
+    // One spectrogram row per integer AMU
+    spectrogram_cache_ = std::make_shared<SpectrogramCache>(RGAData::MAX_UNIT - RGAData::MIN_UNIT + 1);
+
+    // Memory budget shared by all sensor buffers
+    memory_budget_bytes_ = config_.getMemoryBudgetMB() * 1024 * 1024;
+    prefetch_budget_ = config_.getPrefetchBudget();
+
+    // Initialize the InfluxDB connection. It is checked by the catalogue refresh, not here
     influxdb_ = InfluxDatabase(host, port, org, epitrend_bucket, user, password, precision, token, true);
 
-    // Check connection for a maximum of 10 seconds
-    for (int i = 0; i < 10; i++) {
-        std::this_thread::sleep_for(std::chrono::seconds(1));
-        if (influxdb_.checkConnection(false)) {
-            break;
-        } else if (i == 9) {
-            // If connection fails after 10 seconds, stop the program
-            std::cerr << "Failed to connect to InfluxDB" << "\n";
-            std::exit(1);
-        }
+    // Start from the sensor catalogue cached by the last run
+    catalogue_file_ = config_.getSensorCatalogueFile();
+    auto catalogue = std::make_shared<SensorCatalogue>();
+    if (catalogue->load(catalogue_file_)) {
+        std::cout << "Loaded " << catalogue->size() << " sensors from " << catalogue_file_ << "\n";
+        catalogue_.store(std::move(catalogue));
     }
-
 }
 
 // Destructor
 DataManager::~DataManager() {
     stopBackgroundUpdates();
+
+    // Stop the preload threads before the registry goes away, since their callbacks look buffers up in it
+    for (auto& [sensor, buffer] : getSensorBuffers()) {
+        buffer->stopPreload();
+    }
 }
 
 // Start background updates
 void DataManager::startBackgroundUpdates() {
     background_thread_running_ = true;
     background_thread_ = std::thread(&DataManager::backgroundUpdateTask, this);
+
+    catalogue_thread_running_ = true;
+    catalogue_thread_ = std::thread(&DataManager::catalogueRefreshTask, this);
 }
 
 // Stop background updates
 void DataManager::stopBackgroundUpdates() {
-    background_thread_running_ = false;
+    {
+        std::lock_guard<std::mutex> lock(sensor_ranges_mutex_);
+        background_thread_running_ = false;
+    }
+    update_condition_.notify_one();
     if (background_thread_.joinable()) {
         background_thread_.join();
     }
+
+    {
+        std::lock_guard<std::mutex> lock(catalogue_thread_mutex_);
+        catalogue_thread_running_ = false;
+    }
+    catalogue_condition_.notify_one();
+    if (catalogue_thread_.joinable()) {
+        catalogue_thread_.join();
+    }
 }
 
-// Background update task
+// Background update task. Sleeps until a sensor range changes (or MAINTENANCE_INTERVAL passes),
+// then pushes the merged ranges of the dirty sensors to their buffers
 void DataManager::backgroundUpdateTask() {
     while (background_thread_running_) {
+        std::unordered_map<SensorHandle, AppliedRange> local_merged_ranges;
+        std::unordered_map<int, SpectrogramRange> spectrogram_ranges;
+
+        // Wait for dirty sensors and take their merged ranges
         {
-            std::unordered_map<std::string, std::pair<Timestamp, Timestamp>> local_merged_ranges;
-
-            // Copy sensor_ranges_ to a local map
-            {
-                std::lock_guard<std::mutex> lock(sensor_ranges_mutex_);
-                for (const auto& [sensor_id, ranges] : sensor_ranges_) {
-                    local_merged_ranges[sensor_id] = mergeRanges(ranges);
-                }
+            std::unique_lock<std::mutex> lock(sensor_ranges_mutex_);
+            update_condition_.wait_for(lock, MAINTENANCE_INTERVAL, [this]() {
+                return !dirty_sensors_.empty() || !dirty_spectrogram_ranges_.empty() || !background_thread_running_;
+            });
+            for (SensorHandle sensor : dirty_sensors_) {
+                local_merged_ranges[sensor] = applied_ranges_[sensor];
             }
+            dirty_sensors_.clear();
+            spectrogram_ranges.swap(dirty_spectrogram_ranges_);
 
-            // Update buffers_ based on the local copy of the merged ranges
-            {
-                std::lock_guard<std::mutex> lock(buffer_mutex_);
-
-                // Iterate through all sensors and update the data
-                for (const auto& [sensor_id, merged_range] : local_merged_ranges) {
-                    if (local_merged_ranges.empty())
-                        continue;
-
-                    buffers_[sensor_id].setRange(
-                        merged_range.first, merged_range.second,
-                        [this, sensor_id](Timestamp start, Timestamp end) {
-                            preloadData(sensor_id, start, end);
-                        });
-                }
+            // Every plot's range again, for the tiles that were incomplete when last fetched
+            const auto now = std::chrono::steady_clock::now();
+            if (now - spectrogram_refreshed_ >= MAINTENANCE_INTERVAL) {
+                spectrogram_ranges.insert(spectrogram_ranges_.begin(), spectrogram_ranges_.end());
+                spectrogram_refreshed_ = now;
             }
         }
-        std::this_thread::sleep_for(std::chrono::milliseconds(50)); // Update every half-second
+
+        // Update the buffers based on the local copy of the merged ranges
+        for (const auto& [sensor, merged_range] : local_merged_ranges) {
+            getOrCreateSensorBuffer(sensor)->setRange(
+                merged_range.start, merged_range.end, merged_range.preload_start, merged_range.preload_end,
+                [this, sensor](Timestamp start, Timestamp end) {
+                    preloadMissing(sensor, start, end);
+                });
+        }
+
+        for (const auto& [plot_id, range] : spectrogram_ranges) {
+            const bool loaded = fetchSpectrogramTiles(range);
+
+            // Record the outcome unless the plot moved on (or went away) meanwhile
+            std::lock_guard<std::mutex> lock(sensor_ranges_mutex_);
+            auto current = spectrogram_ranges_.find(plot_id);
+            if (current != spectrogram_ranges_.end() && sameTiles(current->second, range)) {
+                current->second.loaded = loaded;
+            }
+        }
+
+        // Keep the buffers within the memory budget
+        enforceMemoryBudget();
+    }
+}
+
+// Mark the sensor dirty if its merged range or prefetch range moved by more than RANGE_CHANGE_TOLERANCE
+// of its width since it was last pushed to the buffer, or if the range is not loaded and the last preload
+// is older than REFETCH_INTERVAL. Must be called with sensor_ranges_mutex_ held
+void DataManager::markRangeChanged(SensorHandle sensor) {
+    const auto [start, end] = mergeRanges(sensor_ranges_[sensor]);
+    const auto [preload_start, preload_end] = prefetchRange(sensor);
+    const auto now = std::chrono::steady_clock::now();
+
+    auto applied = applied_ranges_.find(sensor);
+    auto loaded = loaded_ranges_.find(sensor);
+    if (applied != applied_ranges_.end() && loaded != loaded_ranges_.end()) {
+        const AppliedRange& range = applied->second;
+        const double tolerance = (static_cast<double>(range.end) - static_cast<double>(range.start)) * RANGE_CHANGE_TOLERANCE;
+        auto within = [tolerance](Timestamp a, Timestamp b) {
+            return std::abs(static_cast<double>(a) - static_cast<double>(b)) <= tolerance;
+        };
+        const bool covered = loaded->second.start <= start && end <= loaded->second.end;
+        if (within(start, range.start) && within(end, range.end) &&
+            within(preload_start, range.preload_start) && within(preload_end, range.preload_end) &&
+            (covered || now - loaded->second.requested < REFETCH_INTERVAL)) {
+            return;
+        }
+    }
+
+    applied_ranges_[sensor] = {start, end, preload_start, preload_end};
+    loaded_ranges_[sensor].requested = now;
+    dirty_sensors_.insert(sensor);
+    update_condition_.notify_one();
+}
+
+// Forget what was applied to and loaded into the sensor's buffer, so the next range report preloads it
+// again. Sensors still being viewed are marked dirty right away. Must be called with sensor_ranges_mutex_ held
+void DataManager::invalidateRange(SensorHandle sensor) {
+    applied_ranges_.erase(sensor);
+    loaded_ranges_.erase(sensor);
+
+    auto ranges = sensor_ranges_.find(sensor);
+    auto last_viewed = sensor_last_viewed_.find(sensor);
+    if (ranges != sensor_ranges_.end() && !ranges->second.empty() && last_viewed != sensor_last_viewed_.end() &&
+        std::chrono::steady_clock::now() - last_viewed->second <= SENSOR_VIEW_TIMEOUT) {
+        markRangeChanged(sensor);
+    }
+}
+
+// Record the outcome of a preload of [start, end]. A preload adjoining the loaded range extends it, others
+// replace it. Data cannot be newer than now, so a real-time range reaching past the time of the preload is
+// not covered by it. A failed preload leaves the loaded range as it was. Called from the buffer's preload thread
+void DataManager::recordPreload(SensorHandle sensor, Timestamp start, Timestamp end, bool loaded) {
+    const Timestamp now = secondsToTimestamp(static_cast<double>(std::time(nullptr)) + PLOT_UTC_OFFSET);
+
+    std::lock_guard<std::mutex> lock(sensor_ranges_mutex_);
+    LoadedRange& range = loaded_ranges_[sensor];
+    range.requested = std::chrono::steady_clock::now();
+    if (!loaded) {
+        return;
+    }
+    end = std::min(end, now);
+    if (range.start < range.end && start <= range.end && range.start <= end) {
+        range.start = std::min(range.start, start);
+        range.end = std::max(range.end, end);
+    } else {
+        range.start = start;
+        range.end = end;
+    }
+}
+
+// Preload the parts of [start, end] outside the loaded range, so a real-time range only fetches the data
+// added since it was last preloaded instead of its whole window. Called from the buffer's preload thread
+void DataManager::preloadMissing(SensorHandle sensor, Timestamp start, Timestamp end) {
+    LoadedRange loaded;
+    {
+        std::lock_guard<std::mutex> lock(sensor_ranges_mutex_);
+        auto it = loaded_ranges_.find(sensor);
+        if (it != loaded_ranges_.end()) {
+            loaded = it->second;
+        }
+    }
+
+    if (loaded.start >= loaded.end || end < loaded.start || loaded.end < start) {
+        preloadData(sensor, start, end);
+        return;
+    }
+    if (start < loaded.start) {
+        preloadData(sensor, start, loaded.start);
+    }
+    if (loaded.end < end) {
+        preloadData(sensor, loaded.end, end);
     }
 }
 
 // Get all buffers. UNSAFE ACCESS
-const std::unordered_map<std::string, TimeSeriesBuffer<DataManager::Timestamp, DataManager::Value>>& DataManager::getBuffers() const {
+const std::unordered_map<SensorHandle, DataManager::SensorBufferHandle>& DataManager::getBuffers() const {
     return buffers_;
 }
 
-// Get a snapshot of the buffer for a specific sensor. SAFE ACCESS
-std::vector<std::pair<DataManager::Timestamp, DataManager::Value>> DataManager::getBuffersSnapshot(
-    const std::string& sensor_label, Timestamp start, Timestamp end) {
-    std::lock_guard<std::mutex> lock(buffer_mutex_);
+// Get the labels of all sensors in the catalogue, sorted. SAFE ACCESS
+std::vector<std::string> DataManager::getSensorLabels() {
+    return getSensorCatalogue()->getLabels();
+}
 
-    // Find the buffer
-    auto it = buffers_.find(sensor_label);
-    if (it == buffers_.end()) {
-        return {}; // Return empty if sensor not found
+// Get the current sensor catalogue. SAFE ACCESS
+std::shared_ptr<const SensorCatalogue> DataManager::getSensorCatalogue() const {
+    return catalogue_.load();
+}
+
+// Publish a catalogue with the sensors added
+void DataManager::addToCatalogue(std::vector<SensorCatalogue::Sensor> sensors) {
+    std::lock_guard<std::mutex> lock(catalogue_write_mutex_);
+    auto catalogue = std::make_shared<SensorCatalogue>(*catalogue_.load());
+    if (catalogue->insert(std::move(sensors)) > 0) {
+        catalogue_.store(std::move(catalogue));
     }
+}
+
+// Get the buffer handle of a specific sensor. SAFE ACCESS
+DataManager::SensorBufferHandle DataManager::getSensorBuffer(SensorHandle sensor) {
+    std::shared_lock<std::shared_mutex> lock(registry_mutex_);
+    auto it = buffers_.find(sensor);
+    return it != buffers_.end() ? it->second : nullptr;
+}
 
-    // Get the buffer and ensure it's sorted
-    const auto& buffer = it->second.getData();
-    if (buffer.empty()) {
-        return {};
+// Get the buffer handle of a specific sensor, registering the sensor if needed
+DataManager::SensorBufferHandle DataManager::getOrCreateSensorBuffer(SensorHandle sensor) {
+    if (SensorBufferHandle buffer = getSensorBuffer(sensor)) {
+        return buffer;
     }
+    std::unique_lock<std::shared_mutex> lock(registry_mutex_);
+    auto [it, _] = buffers_.try_emplace(sensor, std::make_shared<SensorBuffer>());
+    return it->second;
+}
 
-    // Use binary search to find the start and end iterators
-    auto lower = std::lower_bound(buffer.begin(), buffer.end(), start,
-        [](const auto& entry, const Timestamp& value) {
-            return entry.first < value;
-        });
+// Copy the registry so the buffers can be worked on without holding registry_mutex_
+std::vector<std::pair<SensorHandle, DataManager::SensorBufferHandle>> DataManager::getSensorBuffers() {
+    std::shared_lock<std::shared_mutex> lock(registry_mutex_);
+    return {buffers_.begin(), buffers_.end()};
+}
 
-    auto upper = std::upper_bound(buffer.begin(), buffer.end(), end,
-        [](const Timestamp& value, const auto& entry) {
-            return value < entry.first;
-        });
+// Get an immutable view of the buffer for a specific sensor over [start, end]. SAFE ACCESS
+// The view shares the buffer's chunks instead of copying samples, and the buffer serves it
+// without locking, so this never waits on other sensors or on writes to this one
+TimeSeriesRangeView<DataManager::Timestamp, DataManager::Value> DataManager::getRangeView(
+    SensorHandle sensor, Timestamp start, Timestamp end) {
+    SensorBufferHandle buffer = getSensorBuffer(sensor);
+    if (!buffer) {
+        return {}; // Return empty if sensor not found
+    }
+    return buffer->getRange(start, end);
+}
 
-    // Create a snapshot using the range
-    return std::vector<std::pair<Timestamp, Value>>(lower, upper);
+// Get the data version of the buffer for a specific sensor. Returns 0 if the sensor is not found. SAFE ACCESS
+std::uint64_t DataManager::getBufferVersion(SensorHandle sensor) {
+    SensorBufferHandle buffer = getSensorBuffer(sensor);
+    return buffer ? buffer->getVersion() : 0;
 }
 
-// Initialize a buffer for a specific machine
+// Add a sensor that is not in the ns table to the catalogue
 void DataManager::addSensor(const std::string& sensor_id) {
-    // Lock the buffer mutex
-    std::lock_guard<std::mutex> lock(buffer_mutex_);
-    buffers_.emplace(sensor_id, TimeSeriesBuffer<Timestamp, Value>());
+    addToCatalogue({{.name = sensor_id, .id = "", .machine = ""}});
 }
 
 // Update range for a specific machine. Callback is used to preload data and clean up old data according to the new range
-void DataManager::updateSensorRange(const std::string& sensor_id, int plot_id, DataManager::Timestamp start, DataManager::Timestamp end) {
-    // Lock the buffer and sensor_ranges mutex
-    std::lock_guard<std::mutex> lock1(buffer_mutex_);
-    std::lock_guard<std::mutex> lock2(sensor_ranges_mutex_);
-
-    auto& ranges = sensor_ranges_[sensor_id];
-    ranges[plot_id] = {start, end}; // Update the specific plot's range
+void DataManager::updateSensorRange(SensorHandle sensor, int plot_id, DataManager::Timestamp start, DataManager::Timestamp end) {
+    // Lock the sensor_ranges mutex
+    AppliedRange merged;
+    {
+        std::lock_guard<std::mutex> lock(sensor_ranges_mutex_);
+        auto& ranges = sensor_ranges_[sensor];
+        ranges[plot_id] = {start, end}; // Update the specific plot's range
+        sensor_last_viewed_[sensor] = std::chrono::steady_clock::now();
+        updatePlotMotion(plot_id, start, end);
 
-    auto [merged_start, merged_end] = mergeRanges(ranges); // Merge ranges across plots
+        std::tie(merged.start, merged.end) = mergeRanges(ranges); // Merge ranges across plots
+        std::tie(merged.preload_start, merged.preload_end) = prefetchRange(sensor);
+        applied_ranges_[sensor] = merged;
+        loaded_ranges_[sensor].requested = std::chrono::steady_clock::now();
+    }
 
-    buffers_[sensor_id].setRange(
-        merged_start, merged_end,
-        [this, sensor_id](Timestamp preload_start, Timestamp preload_end) {
-            preloadData(sensor_id, preload_start, preload_end);
+    getOrCreateSensorBuffer(sensor)->setRange(
+        merged.start, merged.end, merged.preload_start, merged.preload_end,
+        [this, sensor](Timestamp preload_start, Timestamp preload_end) {
+            preloadMissing(sensor, preload_start, preload_end);
         });
 }
 
 // Add new data to a machine's buffer
-void DataManager::addSensorData(const std::string& sensor_id, const std::vector<std::pair<Timestamp, Value>>& data) {
-    // Lock the mutex
-    std::lock_guard<std::mutex> lock(buffer_mutex_);
-    if (buffers_.find(sensor_id) != buffers_.end()) {
-        buffers_[sensor_id].addData(data);
+void DataManager::addSensorData(SensorHandle sensor, const std::vector<std::pair<Timestamp, Value>>& data) {
+    // Only this sensor's buffer is locked while the data is merged
+    if (SensorBufferHandle buffer = getSensorBuffer(sensor)) {
+        buffer->addData(data);
     }
 }
 
 /// Preload data outside the existing range for a specific machine. CURRENTLY IN TESTING
-void DataManager::preloadData(std::string sensor_id, Timestamp start, Timestamp end) {
+void DataManager::preloadData(SensorHandle sensor, Timestamp start, Timestamp end) {
+    const std::string& sensor_id = SensorRegistry::getLabel(sensor);
+
     // Simulate data loading (replace with actual data loading logic)
     std::vector<std::pair<Timestamp, Value>> new_data;
+    constexpr Timestamp one_second = 1000000000;
     if (sensor_id == "sensor_1") {
         // FOR DEVELOPMENT PURPOSES ONLY, REMOVE IF STATEMENT AND REPLACE WITH ACTUAL DATA LOADING LOGIC
-        for (Timestamp t = start; t <= end; t += 1.0) {
-            new_data.emplace_back(t, std::sin(t));
+        for (Timestamp t = start - start % one_second; t <= end; t += one_second) {
+            new_data.emplace_back(t, static_cast<Value>(std::sin(timestampToSeconds(t))));
         }
 
     } else if (sensor_id == "sensor_2") {
         // FOR DEVELOPMENT PURPOSES ONLY, REMOVE IF STATEMENT AND REPLACE WITH ACTUAL DATA LOADING LOGIC
-        for (Timestamp t = start; t <= end; t += 1.0) {
-            new_data.emplace_back(t, 2.0 * std::cos(t / 1.5));
+        for (Timestamp t = start - start % one_second; t <= end; t += one_second) {
+            new_data.emplace_back(t, static_cast<Value>(2.0 * std::cos(timestampToSeconds(t) / 1.5)));
         }
 
     } else {
@@ -193,7 +362,7 @@ void DataManager::preloadData(std::string sensor_id, Timestamp start, Timestamp
 
         // Prepare influx_time_struct and object
         struct influx_time_struct {
-            Timestamp unix_timestamp;
+            double unix_timestamp; // Seconds
             std::string influx_timestamp;
 
             void set_influx_timestamp() {
@@ -217,75 +386,73 @@ void DataManager::preloadData(std::string sensor_id, Timestamp start, Timestamp
                 influx_timestamp = oss.str();
             }
         };
-        influx_time_struct start_time = {.unix_timestamp = start};
+        influx_time_struct start_time = {.unix_timestamp = timestampToSeconds(start)};
         start_time.set_influx_timestamp();
-        influx_time_struct end_time = {.unix_timestamp = end};
+        influx_time_struct end_time = {.unix_timestamp = timestampToSeconds(end)};
         end_time.set_influx_timestamp();
 
         // Prepare the ts query object
-        // Lock the sensor_name_to_id_ mutex
-        ts_read_struct ts_read;
-        {
-            std::lock_guard<std::mutex> lock(sensor_name_to_id_mutex_);
-            ts_read = {
-                    .bucket = "ALL", // REPLACE WITH CONFIG FILE
-                    .sensor_id = sensor_name_to_id_[sensor_id],
-                    .timestamp_start = start_time.influx_timestamp,
-                    .timestamp_end = end_time.influx_timestamp,
-                    .aggregate_period_ms = std::to_string(static_cast<int>(std::ceil((end - start) * 0.25)))
-            };
+        const std::shared_ptr<const SensorCatalogue> catalogue = getSensorCatalogue();
+        const SensorCatalogue::Entry* entry = catalogue->find(sensor_id);
+        if (entry == nullptr) {
+            std::cerr << "DataManager: sensor " << sensor_id << " is not in the sensor catalogue\n";
+            recordPreload(sensor, start, end, false);
+            return;
         }
+        ts_read_struct ts_read = {
+                .bucket = "ALL", // REPLACE WITH CONFIG FILE
+                .sensor_id = entry->id,
+                .timestamp_start = start_time.influx_timestamp,
+                .timestamp_end = end_time.influx_timestamp,
+                .aggregate_period_ms = std::to_string(static_cast<int>(std::ceil(timestampToSeconds(end - start) * 0.25)))
+        };
         ts_read.set_read_query();
 
         // Query the data from the database
         std::string response;
-        std::cout << "Querying data for sensor: " << sensor_id << "\n";
-        std::cout << "Query: " << ts_read.read_query << "\n";
-        influxdb_.queryData2(response, ts_read.read_query);
+        try {
+            influxdb_.queryData2(response, ts_read.read_query);
+        } catch (const std::exception& e) {
+            // Retried after REFETCH_INTERVAL while the range is still viewed
+            std::cerr << "DataManager: query for sensor " << sensor_id << " failed: " << e.what() << "\n";
+            recordPreload(sensor, start, end, false);
+            return;
+        }
 
-        // Parse the response
-        std::vector<std::unordered_map<std::string,std::string>> parsed_response =
-            influxdb_.parseQueryResponse(response);
+        // Parse the response into an arena that is released in one shot at the end of this scope
+        std::pmr::monotonic_buffer_resource arena(response.size() * 2, getQueryMemoryResource());
+        std::pmr::vector<InfluxDatabase::QueryRow> parsed_response = influxdb_.parseQueryResponseInto(response, &arena);
 
         // Check if parsed_response is empty
         if (parsed_response.empty()) {
-            std::cout << "Parsed response is empty----------!!!-------------\n";
+            recordPreload(sensor, start, end, true); // No data in the range
             return;
-        } else {
-            std::cout << "Size of parsed response: " << parsed_response.size() << "\n";
         }
 
         // Extract the data from the parsed response
         for (const auto& element: parsed_response) {
             // Convert the time string to Unix time double
             if (element.find("_time") == element.end() || element.find("_value") == element.end()) {
-                std::cout << "No _time or _value key found in parsed query----------!!!-------------\n";
+                std::cerr << "DataManager: no _time or _value key in the query response for sensor " << sensor_id << "\n";
                 break;
             }
-            std::string time_str = element.at("_time");
             std::tm tm = {};
-            std::istringstream ss(time_str);
+            std::istringstream ss(std::string(element.at("_time")));
             ss >> std::get_time(&tm, "%Y-%m-%dT%H:%M:%S.%fZ");
             std::time_t time = std::mktime(&tm);
 
             // Convert from UTC to AEST time
-            time += 10 * 3600; // 10 hours
+            time += static_cast<std::time_t>(PLOT_UTC_OFFSET);
 
             // Append time and value to the data vector
-            new_data.push_back(std::make_pair(time, std::stod(element.at("_value"))));
+            new_data.push_back(std::make_pair(
+                static_cast<Timestamp>(time) * 1000000000, static_cast<Value>(std::strtod(element.at("_value").c_str(), nullptr))));
         }
 
     }
 
-    // Create a copy of sensor_id
-    std::string sensor_id_copy = sensor_id;
-
-    std::cout << "Preloaded data for sensor: " << sensor_id_copy << "\n";
-    // Set precision for output
-    std::cout << std::fixed << std::setprecision(10);
-    std::cout << "Start: " << start << ", End: " << end << "\n";
-
-    addSensorData(sensor_id_copy, new_data);
+    addSensorData(sensor, new_data);
+    recordPreload(sensor, start, end, true);
 }
 
 // Merge ranges across all plots for a specific sensor
@@ -302,10 +469,407 @@ std::pair<DataManager::Timestamp, DataManager::Timestamp> DataManager::mergeRang
 }
 
 // Set the range for a specific sensor
-void DataManager::setSensorRange(const std::string& sensor_id, int plot_id, Timestamp start, Timestamp end) {
+void DataManager::setSensorRange(SensorHandle sensor, int plot_id, Timestamp start, Timestamp end) {
     // Lock the mutex
     std::lock_guard<std::mutex> lock(sensor_ranges_mutex_);
-    sensor_ranges_[sensor_id][plot_id] = {start, end};
+    auto& ranges = sensor_ranges_[sensor];
+
+    // Count whether a moved range was already covered by what was prefetched for it
+    auto previous = ranges.find(plot_id);
+    if (previous != ranges.end() && previous->second != std::make_pair(start, end)) {
+        auto applied = applied_ranges_.find(sensor);
+        if (applied != applied_ranges_.end() &&
+            applied->second.preload_start <= start && end <= applied->second.preload_end) {
+            ++prefetch_stats_.hits;
+        } else {
+            ++prefetch_stats_.misses;
+        }
+    }
+
+    ranges[plot_id] = {start, end};
+    sensor_last_viewed_[sensor] = std::chrono::steady_clock::now();
+    updatePlotMotion(plot_id, start, end);
+    markRangeChanged(sensor);
+}
+
+
+
+
+// ==================================================
+// Predictive prefetch
+// ==================================================
+DataManager::PrefetchStats DataManager::getPrefetchStats() {
+    std::lock_guard<std::mutex> lock(sensor_ranges_mutex_);
+    return prefetch_stats_;
+}
+
+// Update the motion estimate of a plot from the range it reports. Every sensor of the plot reports the same
+// range each frame, so only the first report of a new range counts
+void DataManager::updatePlotMotion(int plot_id, Timestamp start, Timestamp end) {
+    const auto now = std::chrono::steady_clock::now();
+    auto [it, inserted] = plot_motion_.try_emplace(plot_id);
+    PlotMotion& motion = it->second;
+    if (!inserted && motion.start == start && motion.end == end) {
+        return;
+    }
+
+    const double elapsed = std::chrono::duration<double>(now - motion.updated).count();
+    if (inserted || now - motion.updated > MOTION_TIMEOUT || elapsed <= 0) {
+        // First range, or the plot was still: start over
+        motion.velocity = 0;
+        motion.zoom_rate = 0;
+    } else {
+        const double centre_shift = (static_cast<double>(start) + static_cast<double>(end)) / 2 -
+            (static_cast<double>(motion.start) + static_cast<double>(motion.end)) / 2;
+        const double width = std::max(1.0, static_cast<double>(end) - static_cast<double>(start));
+        const double previous_width = std::max(1.0, static_cast<double>(motion.end) - static_cast<double>(motion.start));
+        motion.velocity += MOTION_SMOOTHING * (centre_shift / elapsed - motion.velocity);
+        motion.zoom_rate += MOTION_SMOOTHING * (std::log(width / previous_width) / elapsed - motion.zoom_rate);
+    }
+    motion.start = start;
+    motion.end = end;
+    motion.updated = now;
+}
+
+// Range to prefetch for a plot showing [start, end], extrapolated from the plot's motion
+std::pair<DataManager::Timestamp, DataManager::Timestamp> DataManager::predictRange(
+    int plot_id, Timestamp start, Timestamp end) const {
+    const double width = static_cast<double>(end) - static_cast<double>(start);
+    const double horizon = std::chrono::duration<double>(PREFETCH_HORIZON).count();
+
+    double pan = 0; // Expected shift of the range, in plot widths (negative towards the past)
+    double zoom_out = 0; // Expected growth of the range width, in plot widths
+    auto it = plot_motion_.find(plot_id);
+    if (it != plot_motion_.end() && width > 0 &&
+        std::chrono::steady_clock::now() - it->second.updated <= MOTION_TIMEOUT) {
+        pan = it->second.velocity * horizon / width;
+        zoom_out = std::max(0.0, std::expm1(it->second.zoom_rate * horizon));
+    }
+
+    // Margins: the travel ahead is added in front, the margin behind shrinks to nothing as the pan speeds up
+    const double ahead = BASE_PRELOAD_FACTOR + std::abs(pan);
+    const double behind = BASE_PRELOAD_FACTOR * std::max(0.0, 1.0 - std::abs(pan) / BASE_PRELOAD_FACTOR);
+    double before = (pan < 0 ? ahead : behind) + zoom_out / 2;
+    double after = (pan < 0 ? behind : ahead) + zoom_out / 2;
+
+    // Keep within the budget
+    const double budget = std::max(0.0, prefetch_budget_);
+    if (before + after > budget) {
+        const double scale = before + after > 0 ? budget / (before + after) : 0;
+        before *= scale;
+        after *= scale;
+    }
+
+    // Saturate instead of overflowing (e.g. fully zoomed out plots)
+    constexpr double limit = 9.2e18;
+    auto clamp = [limit](double timestamp) {
+        return static_cast<Timestamp>(std::clamp(timestamp, -limit, limit));
+    };
+    return {std::min(start, clamp(static_cast<double>(start) - before * width)),
+            std::max(end, clamp(static_cast<double>(end) + after * width))};
+}
+
+// Union of the prefetch ranges of all plots showing the sensor. Must be called with sensor_ranges_mutex_ held
+std::pair<DataManager::Timestamp, DataManager::Timestamp> DataManager::prefetchRange(SensorHandle sensor) const {
+    auto ranges = sensor_ranges_.find(sensor);
+    if (ranges == sensor_ranges_.end() || ranges->second.empty()) {
+        return {0, 0};
+    }
+    bool first = true;
+    std::pair<Timestamp, Timestamp> merged;
+    for (const auto& [plot_id, range] : ranges->second) {
+        const auto [start, end] = predictRange(plot_id, range.first, range.second);
+        merged = first ? std::make_pair(start, end)
+                       : std::make_pair(std::min(merged.first, start), std::max(merged.second, end));
+        first = false;
+    }
+    return merged;
+}
+
+
+
+
+// ==================================================
+// Memory governor
+// ==================================================
+std::size_t DataManager::getMemoryBudget() const {
+    return memory_budget_bytes_;
+}
+
+// Get the memory held by all buffers. SAFE ACCESS
+std::size_t DataManager::getTotalMemoryUsage() {
+    std::size_t total = 0;
+    for (const auto& [sensor_id, buffer] : getSensorBuffers()) {
+        total += buffer->getByteSize();
+    }
+    return total;
+}
+
+// Get the memory held by each buffer. SAFE ACCESS
+std::unordered_map<std::string, std::size_t> DataManager::getMemoryUsage() {
+    std::unordered_map<std::string, std::size_t> usage;
+    for (const auto& [sensor, buffer] : getSensorBuffers()) {
+        usage[SensorRegistry::getLabel(sensor)] = buffer->getByteSize();
+    }
+    return usage;
+}
+
+// Evict chunks until all buffers together fit in the memory budget. Least recently viewed sensors go first:
+// data outside the viewed ranges is dropped before anything else, and data of sensors that are still
+// being viewed is never dropped (it would just be preloaded again)
+void DataManager::enforceMemoryBudget() {
+    using Clock = std::chrono::steady_clock;
+
+    // Copy the view times so sensor_ranges_mutex_ is not held while evicting
+    std::unordered_map<SensorHandle, Clock::time_point> last_viewed;
+    {
+        std::lock_guard<std::mutex> lock(sensor_ranges_mutex_);
+        last_viewed = sensor_last_viewed_;
+    }
+
+    // Collect the non-empty buffers with their last view time
+    struct Candidate {
+        Clock::time_point last_viewed;
+        SensorHandle sensor;
+        SensorBufferHandle buffer;
+    };
+    std::vector<Candidate> candidates;
+    std::size_t total = 0;
+    for (auto& [sensor, buffer] : getSensorBuffers()) {
+        const std::size_t bytes = buffer->getByteSize();
+        if (bytes == 0) {
+            continue;
+        }
+        total += bytes;
+        auto it = last_viewed.find(sensor);
+        candidates.push_back({it != last_viewed.end() ? it->second : Clock::time_point::min(), sensor, std::move(buffer)});
+    }
+    if (total <= memory_budget_bytes_) {
+        memory_budget_warning_ = false;
+        return;
+    }
+
+    // Least recently viewed first
+    std::sort(candidates.begin(), candidates.end(),
+        [](const Candidate& a, const Candidate& b) { return a.last_viewed < b.last_viewed; });
+
+    // First pass: drop the data outside the current ranges and their preload margins. Nothing a preload
+    // would load again goes, so the applied ranges stay valid
+    for (const auto& candidate : candidates) {
+        if (total <= memory_budget_bytes_) {
+            break;
+        }
+        total -= std::min(total, candidate.buffer->evict(total - memory_budget_bytes_, true));
+    }
+
+    // Second pass: drop all the data of sensors that are not viewed anymore. Their ranges are invalidated,
+    // so a plot showing them again reloads the data instead of staying empty until it is moved
+    const auto now = Clock::now();
+    std::vector<SensorHandle> invalidated;
+    for (const auto& candidate : candidates) {
+        if (total <= memory_budget_bytes_) {
+            break;
+        }
+        if (now - candidate.last_viewed <= SENSOR_VIEW_TIMEOUT) {
+            continue;
+        }
+        const std::size_t freed = candidate.buffer->evict(total - memory_budget_bytes_, false);
+        if (freed > 0) {
+            invalidated.push_back(candidate.sensor);
+        }
+        total -= std::min(total, freed);
+    }
+    if (!invalidated.empty()) {
+        std::lock_guard<std::mutex> lock(sensor_ranges_mutex_);
+        for (SensorHandle sensor : invalidated) {
+            invalidateRange(sensor);
+        }
+    }
+
+    // Warn once when the viewed data alone exceeds the budget
+    if (total > memory_budget_bytes_ && !memory_budget_warning_) {
+        std::cerr << "DataManager: viewed sensor data (" << total / (1024 * 1024) << " MB) exceeds the memory budget ("
+                  << memory_budget_bytes_ / (1024 * 1024) << " MB)\n";
+    }
+    memory_budget_warning_ = total > memory_budget_bytes_;
+}
+
+
+
+
+// ==================================================
+// RGA spectrogram
+// ==================================================
+namespace {
+// Seconds since the Unix epoch of an InfluxDB RFC 3339 time (e.g. "2025-01-01T00:00:00.5Z")
+bool parseInfluxTime(std::string_view text, double& seconds) {
+    int year = 0;
+    unsigned month = 0, day = 0, hour = 0, minute = 0;
+    double second = 0;
+    const std::string time(text);
+    if (std::sscanf(time.c_str(), "%d-%u-%uT%u:%u:%lf", &year, &month, &day, &hour, &minute, &second) != 6) {
+        return false;
+    }
+    const std::chrono::sys_days date = std::chrono::year{year} / std::chrono::month{month} / std::chrono::day{day};
+    seconds = static_cast<double>(date.time_since_epoch() / std::chrono::seconds(1)) + hour * 3600.0 + minute * 60.0 + second;
+    return true;
+}
+}
+
+std::shared_ptr<SpectrogramCache> DataManager::getSpectrogramCache() const {
+    return spectrogram_cache_;
+}
+
+bool DataManager::sameTiles(const SpectrogramRange& a, const SpectrogramRange& b) {
+    return a.level == b.level &&
+        SpectrogramCache::getTileKey(a.level, a.start) == SpectrogramCache::getTileKey(b.level, b.start) &&
+        SpectrogramCache::getTileKey(a.level, a.end) == SpectrogramCache::getTileKey(b.level, b.end);
+}
+
+// Called every frame by the plots showing the spectrogram. Only wakes the background task when the plot
+// needs a different level or tiles it did not ask for yet, or when its last fetch failed and is older
+// than REFETCH_INTERVAL
+void DataManager::setSpectrogramRange(int plot_id, double start, double end, int pixel_width) {
+    const auto now = std::chrono::steady_clock::now();
+    const SpectrogramRange range = {SpectrogramCache::chooseLevel(start, end, pixel_width), start, end, now};
+
+    std::lock_guard<std::mutex> lock(sensor_ranges_mutex_);
+    auto last = spectrogram_ranges_.find(plot_id);
+    if (last != spectrogram_ranges_.end() && sameTiles(last->second, range) &&
+        (last->second.loaded || now - last->second.requested < REFETCH_INTERVAL)) {
+        return;
+    }
+    spectrogram_ranges_[plot_id] = range;
+    dirty_spectrogram_ranges_[plot_id] = range;
+    update_condition_.notify_one();
+}
+
+void DataManager::removeSpectrogramPlot(int plot_id) {
+    std::lock_guard<std::mutex> lock(sensor_ranges_mutex_);
+    spectrogram_ranges_.erase(plot_id);
+    dirty_spectrogram_ranges_.erase(plot_id);
+}
+
+void DataManager::updateSpectrogramRows() {
+    std::shared_ptr<const SensorCatalogue> catalogue = getSensorCatalogue();
+    if (catalogue == spectrogram_rows_catalogue_) {
+        return;
+    }
+
+    // Every RGA bins sensor goes to the row of the integer AMU its bins are centred on
+    spectrogram_rows_.clear();
+    spectrogram_id_set_.clear();
+    for (const SensorCatalogue::Entry& entry : catalogue->getEntries()) {
+        double center;
+        if (entry.id.empty() || !RGAData::parseSensorName(entry.name, center)) {
+            continue;
+        }
+        const long unit = std::lround(center);
+        if (unit < RGAData::MIN_UNIT || unit > RGAData::MAX_UNIT) {
+            continue;
+        }
+        spectrogram_rows_[entry.id] = static_cast<std::size_t>(unit - RGAData::MIN_UNIT);
+        spectrogram_id_set_ += (spectrogram_id_set_.empty() ? "\"" : ", \"") + entry.id + "\"";
+    }
+    spectrogram_rows_catalogue_ = std::move(catalogue);
+}
+
+bool DataManager::fetchSpectrogramTiles(const SpectrogramRange& range) {
+    const std::vector<SpectrogramCache::TileKey> missing =
+        spectrogram_cache_->getMissingTiles(range.level, range.start, range.end);
+    if (missing.empty()) {
+        return true;
+    }
+    updateSpectrogramRows();
+    if (spectrogram_rows_.empty()) {
+        return false; // No RGA sensors in the catalogue (yet)
+    }
+
+    // Prepare the time-series (ts) query of all RGA bins, aggregated to one max per column
+    struct ts_read_bins_struct {
+        std::string bucket;
+        std::string sensor_id_set;
+        long long start; // Unix seconds
+        long long stop;
+        std::string column_ms;
+        std::string read_query = "";
+        void set_read_query(){read_query = "from(bucket: \"" + bucket + "\") "
+            "|> range(start: " + std::to_string(start) + ", stop: " + std::to_string(stop) + ")"
+            "|> filter(fn: (r) => r[\"_measurement\"] == \"ts\")"
+            "|> filter(fn: (r) => contains(value: r[\"sensor_id_\"], set: [" + sensor_id_set + "]))"
+            "|> aggregateWindow(every: " + column_ms + "ms, fn: max, createEmpty: false, timeSrc: \"_start\")";
+        }
+    };
+
+    // Tiles are aligned to whole columns, so each run of consecutive missing tiles is one query. Tiles
+    // ending after now are stored as incomplete, so the maintenance refresh fetches them again
+    const double column_seconds = SpectrogramCache::getColumnSeconds(range.level);
+    const double now = static_cast<double>(std::time(nullptr)) + PLOT_UTC_OFFSET;
+    for (std::size_t run_begin = 0; run_begin < missing.size();) {
+        std::size_t run_end = run_begin + 1;
+        while (run_end < missing.size() && missing[run_end].index == missing[run_end - 1].index + 1) {
+            ++run_end;
+        }
+        const double start = SpectrogramCache::getTileRange(missing[run_begin]).first;
+        const double end = SpectrogramCache::getTileRange(missing[run_end - 1]).second;
+
+        ts_read_bins_struct ts_read = {
+            .bucket = "ALL", // REPLACE WITH CONFIG FILE
+            .sensor_id_set = spectrogram_id_set_,
+            .start = static_cast<long long>(std::floor(start - PLOT_UTC_OFFSET)),
+            .stop = static_cast<long long>(std::ceil(end - PLOT_UTC_OFFSET)),
+            .column_ms = std::to_string(std::llround(column_seconds * 1000))
+        };
+        ts_read.set_read_query();
+
+        std::string response;
+        try {
+            influxdb_.queryData2(response, ts_read.read_query);
+        } catch (const std::exception& e) {
+            // The tiles stay missing and are asked for again after REFETCH_INTERVAL
+            std::cerr << "DataManager: spectrogram query failed: " << e.what() << "\n";
+            return false;
+        }
+
+        // Parse the response into an arena that is released in one shot at the end of this iteration
+        std::pmr::monotonic_buffer_resource arena(response.size() * 2, getQueryMemoryResource());
+        std::pmr::vector<InfluxDatabase::QueryRow> parsed_response = influxdb_.parseQueryResponseInto(response, &arena);
+
+        std::vector<SpectrogramCache::Tile> tiles;
+        tiles.reserve(run_end - run_begin);
+        for (std::size_t i = run_begin; i < run_end; ++i) {
+            tiles.push_back(spectrogram_cache_->makeTile(missing[i]));
+            tiles.back().complete = SpectrogramCache::getTileRange(missing[i]).second <= now;
+        }
+        for (const auto& element : parsed_response) {
+            auto sensor_id = element.find("sensor_id_");
+            auto time_text = element.find("_time");
+            auto value_text = element.find("_value");
+            if (sensor_id == element.end() || time_text == element.end() || value_text == element.end()) {
+                continue;
+            }
+            auto row = spectrogram_rows_.find(std::string(sensor_id->second));
+            double time;
+            if (row == spectrogram_rows_.end() || !parseInfluxTime(time_text->second, time)) {
+                continue;
+            }
+            time += PLOT_UTC_OFFSET;
+
+            const std::int64_t tile = SpectrogramCache::getTileKey(range.level, time).index - missing[run_begin].index;
+            if (tile < 0 || tile >= static_cast<std::int64_t>(tiles.size())) {
+                continue;
+            }
+            spectrogram_cache_->addSample(tiles[static_cast<std::size_t>(tile)], time, row->second,
+                std::strtod(value_text->second.c_str(), nullptr));
+        }
+
+        // Store empty tiles too, so they are not asked for again
+        for (SpectrogramCache::Tile& tile : tiles) {
+            spectrogram_cache_->storeTile(std::move(tile));
+        }
+        run_begin = run_end;
+    }
+    return true;
 }
 
 
@@ -314,59 +878,154 @@ void DataManager::setSensorRange(const std::string& sensor_id, int plot_id, Time
 // ==================================================
 // InfluxDB connection
 // ==================================================
-void DataManager::setInfluxDBSensors() {
-    // Prepare name-series (ns) query read all data statement
-    struct ns_read_all_struct {
+// Catalogue refresh task. Refreshes right away, then every CATALOGUE_REFRESH_INTERVAL
+void DataManager::catalogueRefreshTask() {
+    while (true) {
+        refreshSensorCatalogue();
+
+        std::unique_lock<std::mutex> lock(catalogue_thread_mutex_);
+        catalogue_condition_.wait_for(lock, CATALOGUE_REFRESH_INTERVAL, [this]() { return !catalogue_thread_running_; });
+        if (!catalogue_thread_running_) {
+            break;
+        }
+    }
+}
+
+bool DataManager::refreshSensorCatalogue() {
+    // queryData2 throws when InfluxDB cannot be reached
+    bool connected = false;
+    try {
+        connected = influxdb_.checkConnection(false);
+    } catch (const std::exception& e) {
+        std::cerr << "DataManager: " << e.what() << "\n";
+    }
+    if (!connected) {
+        std::cerr << "Failed to connect to InfluxDB, the sensor catalogue was not refreshed\n";
+        return false;
+    }
+
+    // Each ns sensor is one series, so while the ns table has no more series than the catalogue has sensors
+    // there is nothing new. The count comes from the series index, without reading the rows. If it cannot
+    // be read (e.g. an InfluxDB without influxdb.cardinality), the rows are read anyway
+    const std::shared_ptr<const SensorCatalogue> known = getSensorCatalogue();
+    if (known->getWatermark() >= 0) {
+        struct ns_count_struct {
+            std::string bucket;
+            std::string read_query = "";
+            void set_read_query(){read_query = "import \"influxdata/influxdb\"\n"
+                "influxdb.cardinality(bucket: \"" + bucket + "\", start: -50y, stop: 100y, "
+                "predicate: (r) => r[\"_measurement\"] == \"ns\")";
+            }
+        };
+        ns_count_struct ns_count = {.bucket = "ALL"}; // REPLACE WITH CONFIG FILE
+        ns_count.set_read_query();
+
+        std::string count_response;
+        try {
+            influxdb_.queryData2(count_response, ns_count.read_query);
+        } catch (const std::exception& e) {
+            std::cerr << "DataManager: sensor catalogue query failed: " << e.what() << "\n";
+            return false;
+        }
+        std::pmr::monotonic_buffer_resource count_arena(count_response.size() * 2, getQueryMemoryResource());
+        std::pmr::vector<InfluxDatabase::QueryRow> count_rows = influxdb_.parseQueryResponseInto(count_response, &count_arena);
+        if (!count_rows.empty() && count_rows.front().find("_value") != count_rows.front().end()) {
+            const std::size_t series = std::strtoull(count_rows.front().at("_value").c_str(), nullptr, 10);
+            const auto with_id = std::count_if(known->getEntries().begin(), known->getEntries().end(),
+                [](const SensorCatalogue::Entry& entry) { return !entry.id.empty(); });
+            if (series == static_cast<std::size_t>(with_id)) {
+                return true;
+            }
+        }
+    }
+
+    // Prepare name-series (ns) query read statement. All ns rows share one timestamp, so rows newer than
+    // the catalogue are told apart by their sensor_id (stored as a string in _value). The id filter is not
+    // pushed down to storage, so this reads the whole ns table
+    struct ns_read_new_struct {
         std::string bucket;
-        std::string read_query;
+        long long watermark = -1; // -1 reads all rows
+        std::string read_query = "";
         void set_read_query(){read_query = "from(bucket: \"" + bucket + "\") "
             "|> range(start: -50y, stop: 100y)"
             "|> filter(fn: (r) => r[\"_measurement\"] == \"ns\")";
+            if (watermark >= 0) {
+                read_query += "|> filter(fn: (r) => int(v: r[\"_value\"]) > " + std::to_string(watermark) + ")";
+            }
         }
     };
 
     // Prepare the query structs. REPLACE WITH CONFIG FILE
-    ns_read_all_struct ns_read_all_epitrend = {.bucket = "ALL"};
-    ns_read_all_epitrend.set_read_query();
+    ns_read_new_struct ns_read_new_epitrend = {.bucket = "ALL", .watermark = known->getWatermark()};
+    ns_read_new_epitrend.set_read_query();
 
-    // Read the InfluxDB "ns" table for all data
+    // Read the new rows of the InfluxDB "ns" table
     std::string response;
-    response = "";
-    influxdb_.queryData2(response, ns_read_all_epitrend.read_query);
+    try {
+        influxdb_.queryData2(response, ns_read_new_epitrend.read_query);
+    } catch (const std::exception& e) {
+        std::cerr << "DataManager: sensor catalogue query failed: " << e.what() << "\n";
+        return false;
+    }
 
-    // Parse the response
-    std::vector<std::unordered_map<std::string, std::string>> parsed_response = influxdb_.parseQueryResponse(response);
+    // Parse the response into an arena that is released in one shot at the end of this function
+    std::pmr::monotonic_buffer_resource arena(response.size() * 2, getQueryMemoryResource());
+    std::pmr::vector<InfluxDatabase::QueryRow> parsed_response = influxdb_.parseQueryResponseInto(response, &arena);
 
-    // Add the sensors to the DataManager
-    // Lock the sensor_name_to_id_ and sensor_id_to_name_ mutexes
-    {
-        std::lock_guard<std::mutex> lock1(sensor_name_to_id_mutex_);
-        std::lock_guard<std::mutex> lock2(sensor_id_to_name_mutex_);
-
-        for(const auto& element : parsed_response) {
-            // Check sensor_ and sensor_id_ keys exist (ns table should contain these keys)
-            if(element.find("sensor_") == element.end() || element.find("_value") == element.end()) {
-                std::cerr << "Error in DataManager::setInfluxDBSensors call: "
-                "sensor_ or sensor_id key not found in ns table\n";
-                throw std::runtime_error("Error in DataManager::setInfluxDBSensors call: "
-                "sensor_ or sensor_id key not found in ns table\n");
-            }
+    // Add the sensors to the catalogue. Their buffers are only created once they are plotted
+    std::vector<SensorCatalogue::Sensor> sensors;
+    sensors.reserve(parsed_response.size());
+    for(const auto& element : parsed_response) {
+        // Check sensor_ and sensor_id_ keys exist (ns table should contain these keys)
+        if(element.find("sensor_") == element.end() || element.find("_value") == element.end()) {
+            std::cerr << "Error in DataManager::refreshSensorCatalogue call: "
+            "sensor_ or sensor_id key not found in ns table\n";
+            return false;
+        }
 
-            // Cache the sensor-name and sensor-id pairs
-            sensor_name_to_id_[element.at("sensor_")] = element.at("_value");
-            sensor_id_to_name_[element.at("_value")] = element.at("sensor_");
+        auto machine = element.find("machine_");
+        sensors.push_back({
+            .name = std::string(element.at("sensor_")),
+            .id = std::string(element.at("_value")),
+            .machine = machine != element.end() ? std::string(machine->second) : std::string()
+        });
+    }
+    if (sensors.empty()) {
+        return true;
+    }
 
-        }
+    addToCatalogue(std::move(sensors));
+    {
+        std::lock_guard<std::mutex> lock(catalogue_write_mutex_); // Serialize writers of the file
+        getSensorCatalogue()->save(catalogue_file_);
     }
+    reloadEmptySensors();
+    return true;
+}
 
-    // Lock the buffer and sensor_name_to_id_ mutexes
+// Plotted sensors that have no data yet, typically because they were plotted before they were in the
+// catalogue (e.g. a first start without a cached catalogue), are preloaded again
+void DataManager::reloadEmptySensors() {
+    std::vector<SensorHandle> plotted;
     {
-        std::lock_guard<std::mutex> lock1(buffer_mutex_);
-        std::lock_guard<std::mutex> lock2(sensor_name_to_id_mutex_);
+        std::lock_guard<std::mutex> lock(sensor_ranges_mutex_);
+        for (const auto& [sensor, ranges] : sensor_ranges_) {
+            if (!ranges.empty()) {
+                plotted.push_back(sensor);
+            }
+        }
+    }
 
-        // Add the sensors to the DataManager
-        for(const auto& [sensor_name, sensor_id] : sensor_name_to_id_) {
-            buffers_.emplace(sensor_name, TimeSeriesBuffer<Timestamp, Value>());
+    std::vector<SensorHandle> empty;
+    for (SensorHandle sensor : plotted) {
+        SensorBufferHandle buffer = getSensorBuffer(sensor);
+        if (!buffer || buffer->size() == 0) {
+            empty.push_back(sensor);
         }
     }
+
+    std::lock_guard<std::mutex> lock(sensor_ranges_mutex_);
+    for (SensorHandle sensor : empty) {
+        invalidateRange(sensor);
+    }
 }
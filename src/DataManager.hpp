@@ -1,31 +1,80 @@
 #pragma once
 #include <vector>
 #include <string>
+#include <chrono>
+#include <unordered_map>
+#include <set>
+#include <condition_variable>
+#include <shared_mutex>
 
 #include "TimeSeriesBuffer.hpp"
+#include "SensorRegistry.hpp"
+#include "SpectrogramCache.hpp"
+#include "SensorCatalogue.hpp"
 #include "InfluxDatabase.hpp"
 #include "Config.hpp"
 
 class DataManager {
 public:
-    using Timestamp = double; // Or another suitable type
-    using Value = double;
+    using Timestamp = SensorTimestamp; // Nanoseconds since the Unix epoch
+    using Value = SensorValue;
+    using SensorBuffer = TimeSeriesBuffer<Timestamp, Value>;
+    using SensorBufferHandle = std::shared_ptr<SensorBuffer>; // Stable for the sensor's lifetime
 
     DataManager();
     ~DataManager();
 
-    const std::unordered_map<std::string, TimeSeriesBuffer<Timestamp, Value>>& getBuffers() const; // Unsafe access
-    std::vector<std::pair<Timestamp, Value>> getBuffersSnapshot(
-        const std::string& sensor_label, Timestamp start, Timestamp end); // Safe access
+    const std::unordered_map<SensorHandle, SensorBufferHandle>& getBuffers() const; // Unsafe access
+    std::vector<std::string> getSensorLabels(); // Safe access. All sensors in the catalogue, sorted
+    std::shared_ptr<const SensorCatalogue> getSensorCatalogue() const; // Safe access, immutable snapshot
+    SensorBufferHandle getSensorBuffer(SensorHandle sensor); // Safe access, nullptr if not found
+    TimeSeriesRangeView<Timestamp, Value> getRangeView(
+        SensorHandle sensor, Timestamp start, Timestamp end); // Safe access, zero-copy
+    std::uint64_t getBufferVersion(SensorHandle sensor); // Safe access
 
-    void addSensor (const std::string& sensor_id);
-    void updateSensorRange(const std::string& sensor_id, int plot_id, Timestamp start, Timestamp end);
-    void addSensorData(const std::string& sensor_id, const std::vector<std::pair<Timestamp, Value>>& data);
+    void addSensor (const std::string& sensor_id); // Adds to the catalogue. The buffer is created on first use
+    void updateSensorRange(SensorHandle sensor, int plot_id, Timestamp start, Timestamp end);
+    void addSensorData(SensorHandle sensor, const std::vector<std::pair<Timestamp, Value>>& data);
 
     void startBackgroundUpdates();
     void stopBackgroundUpdates();
 
-    void setSensorRange(const std::string& sensor_id, int plot_id, Timestamp start, Timestamp end);
+    void setSensorRange(SensorHandle sensor, int plot_id, Timestamp start, Timestamp end);
+
+
+
+
+    // ==================================================
+    // Memory governor
+    // ==================================================
+    std::size_t getMemoryBudget() const; // Bytes
+    std::size_t getTotalMemoryUsage(); // Bytes, safe access
+    std::unordered_map<std::string, std::size_t> getMemoryUsage(); // Bytes per sensor, safe access
+
+
+
+
+    // ==================================================
+    // Predictive prefetch
+    // ==================================================
+    struct PrefetchStats {
+        std::size_t hits = 0; // Plot range changes already covered by the prefetched range
+        std::size_t misses = 0;
+    };
+    PrefetchStats getPrefetchStats(); // Safe access
+
+
+
+
+    // ==================================================
+    // RGA spectrogram
+    // ==================================================
+    // Time x AMU max-aggregation of all RGA bins, one row per integer AMU, shared with the views. Plots
+    // showing it report their range and width; the background task then fetches the tiles they miss, and
+    // every MAINTENANCE_INTERVAL fetches again the tiles that reach past the newest data
+    std::shared_ptr<SpectrogramCache> getSpectrogramCache() const;
+    void setSpectrogramRange(int plot_id, double start, double end, int pixel_width); // Plot seconds
+    void removeSpectrogramPlot(int plot_id); // The plot was removed or stopped showing the spectrogram
 
 
 
@@ -33,22 +82,58 @@ public:
     // ==================================================
     // InfluxDB connection
     // ==================================================
-    void setInfluxDBSensors();
+    // Fetch the ns rows newer than the catalogue's watermark (all rows if the catalogue is empty), add them
+    // to the catalogue and save it. The rows are only read when the ns series count (from the series
+    // index) shows sensors the catalogue does not have, since filtering on the id reads every ns row.
+    // Returns false if InfluxDB could not be reached. Runs periodically in the background between
+    // startBackgroundUpdates and stopBackgroundUpdates
+    bool refreshSensorCatalogue();
 
 
 
 
 private:
-    std::unordered_map<std::string, TimeSeriesBuffer<Timestamp, Value>> buffers_;
-    std::unordered_map<std::string, std::unordered_map<int, std::pair<Timestamp, Timestamp>>> sensor_ranges_; // sensor -> plot_id -> range
+    // Sensor registry. registry_mutex_ only guards adding sensors and looking up their handles; the data of
+    // each sensor is synchronized by its own buffer, so work on one sensor never blocks the others.
+    // Buffers only exist for sensors that were plotted; the catalogue lists all of them
+    std::unordered_map<SensorHandle, SensorBufferHandle> buffers_;
+    std::shared_mutex registry_mutex_;
+
+    SensorBufferHandle getOrCreateSensorBuffer(SensorHandle sensor);
+    std::vector<std::pair<SensorHandle, SensorBufferHandle>> getSensorBuffers(); // Snapshot of the registry
+    std::unordered_map<SensorHandle, std::unordered_map<int, std::pair<Timestamp, Timestamp>>> sensor_ranges_; // sensor -> plot_id -> range
 
     std::thread background_thread_;
     std::atomic<bool> background_thread_running_;
 
-    std::mutex buffer_mutex_;
     std::mutex sensor_ranges_mutex_;
 
-    void preloadData(std::string sensor_id, Timestamp start, Timestamp end);
+    // Range changes mark sensors dirty and wake the background task, which only then pushes the merged
+    // ranges to the buffers (and so triggers preloads). Changes within RANGE_CHANGE_TOLERANCE are ignored,
+    // unless the range is not loaded anymore: evicted, a failed preload, or a real-time range past the
+    // newest data loaded. Those are preloaded again at most every REFETCH_INTERVAL
+    constexpr static double RANGE_CHANGE_TOLERANCE = 0.01; // Fraction of the range width
+    constexpr static double PLOT_UTC_OFFSET = 10 * 3600; // Seconds. Plot times are AEST, InfluxDB times UTC
+    constexpr static auto REFETCH_INTERVAL = std::chrono::seconds(1);
+    constexpr static auto MAINTENANCE_INTERVAL = std::chrono::seconds(1); // Memory budget checks when idle
+    struct AppliedRange {
+        Timestamp start, end; // Merged range of the plots
+        Timestamp preload_start, preload_end; // Merged prefetch range of the plots
+    };
+    struct LoadedRange {
+        Timestamp start = 0, end = 0; // Loaded by the preloads so far, up to the time they ran. Failures leave it
+        std::chrono::steady_clock::time_point requested; // Last preload requested or finished
+    };
+    std::unordered_map<SensorHandle, AppliedRange> applied_ranges_; // Guarded by sensor_ranges_mutex_
+    std::unordered_map<SensorHandle, LoadedRange> loaded_ranges_; // Guarded by sensor_ranges_mutex_
+    std::set<SensorHandle> dirty_sensors_; // Guarded by sensor_ranges_mutex_
+    std::condition_variable update_condition_;
+
+    void markRangeChanged(SensorHandle sensor); // Must be called with sensor_ranges_mutex_ held
+    void invalidateRange(SensorHandle sensor); // Must be called with sensor_ranges_mutex_ held
+    void preloadMissing(SensorHandle sensor, Timestamp start, Timestamp end); // The parts not loaded yet
+    void preloadData(SensorHandle sensor, Timestamp start, Timestamp end);
+    void recordPreload(SensorHandle sensor, Timestamp start, Timestamp end, bool loaded);
     void backgroundUpdateTask();
 
     std::pair<Timestamp, Timestamp> mergeRanges(
@@ -58,14 +143,104 @@ private:
 
 
 
+    // ==================================================
+    // Memory governor
+    // ==================================================
+    // A sensor counts as viewed while a plot reports its range at least this often
+    constexpr static auto SENSOR_VIEW_TIMEOUT = std::chrono::seconds(5);
+
+    void enforceMemoryBudget();
+
+    std::size_t memory_budget_bytes_;
+    bool memory_budget_warning_ = false; // Over budget with only viewed data left
+    std::unordered_map<SensorHandle, std::chrono::steady_clock::time_point> sensor_last_viewed_; // Guarded by sensor_ranges_mutex_
+
+
+
+
+    // ==================================================
+    // Predictive prefetch
+    // ==================================================
+    // Each plot's pan velocity and zoom rate are estimated from the successive ranges it reports, and the
+    // prefetch range is extrapolated PREFETCH_HORIZON ahead: margins grow in the direction of motion and
+    // shrink behind it, and grow on both sides when zooming out. The margins never exceed prefetch_budget_
+    // plot widths in total. A still plot gets BASE_PRELOAD_FACTOR on each side
+    constexpr static double BASE_PRELOAD_FACTOR = 0.2; // Fraction of the plot width
+    constexpr static auto PREFETCH_HORIZON = std::chrono::milliseconds(1500);
+    constexpr static auto MOTION_TIMEOUT = std::chrono::milliseconds(300); // Plots that did not move for this long are still
+    constexpr static double MOTION_SMOOTHING = 0.3; // Weight of the newest sample in the motion estimates
+
+    struct PlotMotion {
+        Timestamp start = 0, end = 0; // Last range reported
+        std::chrono::steady_clock::time_point updated;
+        double velocity = 0; // Range centre, nanoseconds per second
+        double zoom_rate = 0; // Log of the range width per second. Positive when zooming out
+    };
+
+    // All three must be called with sensor_ranges_mutex_ held
+    void updatePlotMotion(int plot_id, Timestamp start, Timestamp end);
+    std::pair<Timestamp, Timestamp> predictRange(int plot_id, Timestamp start, Timestamp end) const;
+    std::pair<Timestamp, Timestamp> prefetchRange(SensorHandle sensor) const; // Over all plots showing the sensor
+
+    double prefetch_budget_;
+    std::unordered_map<int, PlotMotion> plot_motion_; // Guarded by sensor_ranges_mutex_
+    PrefetchStats prefetch_stats_; // Guarded by sensor_ranges_mutex_
+
+
+
+
+    // ==================================================
+    // RGA spectrogram
+    // ==================================================
+    struct SpectrogramRange {
+        int level;
+        double start, end; // Plot seconds
+        std::chrono::steady_clock::time_point requested; // Last fetch of the range asked for
+        bool loaded = false; // The last fetch succeeded. Failed ranges are asked for again after REFETCH_INTERVAL
+    };
+    static bool sameTiles(const SpectrogramRange& a, const SpectrogramRange& b);
+
+    // Fetch the missing tiles of the range: one aggregated query over all RGA bins per run of consecutive
+    // tiles. False if a query failed or there are no RGA sensors to query. Background thread only
+    bool fetchSpectrogramTiles(const SpectrogramRange& range);
+    void updateSpectrogramRows(); // Background thread only
+
+    std::shared_ptr<SpectrogramCache> spectrogram_cache_;
+    std::unordered_map<int, SpectrogramRange> spectrogram_ranges_; // Last range asked for per plot. Guarded by sensor_ranges_mutex_
+    std::unordered_map<int, SpectrogramRange> dirty_spectrogram_ranges_; // Guarded by sensor_ranges_mutex_
+    std::chrono::steady_clock::time_point spectrogram_refreshed_; // Last refetch of incomplete tiles. Background thread only
+
+    // Row of every RGA bins sensor id, and the Flux set of those ids, for the catalogue they were built from
+    std::shared_ptr<const SensorCatalogue> spectrogram_rows_catalogue_;
+    std::unordered_map<std::string, std::size_t> spectrogram_rows_;
+    std::string spectrogram_id_set_;
+
+
+
+
     // ==================================================
     // InfluxDB connection
     // ==================================================
     InfluxDatabase influxdb_;
-    std::map<std::string, std::string> sensor_name_to_id_;
-    std::map<std::string, std::string> sensor_id_to_name_;
-    std::mutex sensor_name_to_id_mutex_;
-    std::mutex sensor_id_to_name_mutex_;
+
+    // Catalogue of all sensors. Readers load the published snapshot without locking; writers serialize on
+    // catalogue_write_mutex_ and publish an updated copy (read-copy-update, like TimeSeriesBuffer)
+    std::atomic<std::shared_ptr<const SensorCatalogue>> catalogue_{std::make_shared<const SensorCatalogue>()};
+    std::mutex catalogue_write_mutex_;
+
+    void addToCatalogue(std::vector<SensorCatalogue::Sensor> sensors);
+    void reloadEmptySensors(); // After new sensors are published
+
+    // Background catalogue refresh. The catalogue is loaded from catalogue_file_ at construction, so
+    // startup never waits for InfluxDB. Each refresh costs one series count query
+    constexpr static auto CATALOGUE_REFRESH_INTERVAL = std::chrono::seconds(60);
+    void catalogueRefreshTask();
+
+    std::string catalogue_file_;
+    std::thread catalogue_thread_;
+    std::mutex catalogue_thread_mutex_;
+    std::condition_variable catalogue_condition_;
+    bool catalogue_thread_running_ = false; // Guarded by catalogue_thread_mutex_
 
 
 
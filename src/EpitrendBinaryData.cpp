@@ -1,97 +1,229 @@
 #include "EpitrendBinaryData.hpp"
+#include "series_difference.hpp"
 
 // Setters
-void EpitrendBinaryData::addDataItem( std::string name,
+EpitrendBinaryData::SensorIndex EpitrendBinaryData::internName(std::string_view name) {
+    // Fast path: same sensor as the previous sample
+    if (last_sensor_ < names_.size() && names_[last_sensor_] == name) {
+        return last_sensor_;
+    }
+
+    auto it = name_indices_.find(name);
+    if (it == name_indices_.end()) {
+        const SensorIndex sensor = static_cast<SensorIndex>(names_.size());
+        names_.emplace_back(name);
+        series_.emplace_back();
+        it = name_indices_.emplace(names_.back(), sensor).first;
+    }
+    last_sensor_ = it->second;
+    return last_sensor_;
+}
+
+void EpitrendBinaryData::addDataItem(std::string_view name,
     std::pair<double,double> time_series,
     bool verbose
 ) {
-    // Check if name already exists in map
-    if (allTimeSeriesData.find(name) == allTimeSeriesData.end()) {
-        // Key does not exist so add name and time-series data
-        allTimeSeriesData[name][time_series.first]= time_series.second;
-
-    } else {
-        // Key exists so append to the time-series data
-        // Check if any time-data already exists for the name
-        if (allTimeSeriesData[name].find(time_series.first) == allTimeSeriesData[name].end()) {
-            // Time-data does not exist for the name so add to the map
-            allTimeSeriesData[name][time_series.first] = time_series.second;
-
-        } else {
-            // Time-data does exist so replace the data but also give out warning (if verbose was given)
-            allTimeSeriesData[name][time_series.first] = time_series.second;
-
-            // Give user a warning
-            if (verbose) {
-                std::cerr << std::setprecision(15) << "Warning in EpitrendBinaryData::addDataItem call: time-series data " << time_series.first << " already exists for " << name << ".\n";
+    // Duplicate times are only detected (and warned about) by finalize
+    (void)verbose;
+    addDataItem(internName(name), time_series);
+}
 
-            }
+void EpitrendBinaryData::addDataItem(SensorIndex sensor, std::pair<double,double> time_series) {
+    Series& series = series_[sensor];
+    if (!series.times.empty() && time_series.first <= series.times.back()) {
+        finalized_ = false;
+    }
+    series.times.push_back(time_series.first);
+    series.values.push_back(time_series.second);
 
-        }
+    // Increment byteSize of object
+    byteSize = byteSize + 16 + names_[sensor].length(); // 8 bytes * 2 + 1 byte * number of chars
+}
 
+void EpitrendBinaryData::reserve(std::size_t sensors) {
+    names_.reserve(sensors);
+    series_.reserve(sensors);
+    name_indices_.reserve(sensors);
+}
+
+void EpitrendBinaryData::reserve(SensorIndex sensor, std::size_t samples) {
+    series_[sensor].times.reserve(samples);
+    series_[sensor].values.reserve(samples);
+}
+
+void EpitrendBinaryData::finalize(bool verbose) {
+    if (finalized_) {
+        return;
     }
 
-    // Increment byteSize of object
-    byteSize = byteSize + 16 + name.length(); // 8 bytes * 2 + 1 byte * number of chars
+    std::vector<std::size_t> order;
+    for (SensorIndex sensor = 0; sensor < series_.size(); ++sensor) {
+        Series& series = series_[sensor];
+        if (std::is_sorted(series.times.begin(), series.times.end()) &&
+            std::adjacent_find(series.times.begin(), series.times.end()) == series.times.end()) {
+            continue;
+        }
+
+        // Stable sort keeps equal times in the order added, so the last of each run is the newest
+        order.resize(series.times.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(), [&series](std::size_t a, std::size_t b) {
+            return series.times[a] < series.times[b];
+        });
+
+        Series sorted;
+        sorted.times.reserve(order.size());
+        sorted.values.reserve(order.size());
+        for (std::size_t i = 0; i < order.size(); ++i) {
+            const double time = series.times[order[i]];
+            if (i + 1 < order.size() && series.times[order[i + 1]] == time) {
+                // Time-data is replaced by the newer sample, but give out a warning (if verbose was given)
+                if (verbose) {
+                    std::cerr << std::setprecision(15) << "Warning in EpitrendBinaryData::finalize call: time-series data "
+                    << time << " already exists for " << names_[sensor] << ".\n";
+                }
+                byteSize = byteSize - 16 - static_cast<int>(names_[sensor].length());
+                continue;
+            }
+            sorted.times.push_back(time);
+            sorted.values.push_back(series.values[order[i]]);
+        }
+        series = std::move(sorted);
+    }
+    finalized_ = true;
 }
 
+bool EpitrendBinaryData::is_finalized() const { return finalized_; }
+
 // Getters
-std::unordered_map<std::string, std::unordered_map<double,double>> EpitrendBinaryData::getAllTimeSeriesData() {
-    return allTimeSeriesData;
+std::size_t EpitrendBinaryData::getSensorCount() const { return names_.size(); }
+const std::string& EpitrendBinaryData::getName(SensorIndex sensor) const { return names_[sensor]; }
+std::span<const double> EpitrendBinaryData::getTimes(SensorIndex sensor) const { return series_[sensor].times; }
+std::span<const double> EpitrendBinaryData::getValues(SensorIndex sensor) const { return series_[sensor].values; }
+
+void EpitrendBinaryData::forEachSeries(const std::function<void(const std::string& name,
+    std::span<const double> times, std::span<const double> values)>& visitor) const {
+    for (SensorIndex sensor = 0; sensor < series_.size(); ++sensor) {
+        if (!series_[sensor].times.empty()) {
+            visitor(names_[sensor], series_[sensor].times, series_[sensor].values);
+        }
+    }
 }
+
 int EpitrendBinaryData::getByteSize() { return byteSize;}
 
 // Utility
 void EpitrendBinaryData::printAllTimeSeriesData(){
-        for(auto element : allTimeSeriesData){
-            std::cout << element.first << "\n";
+    finalize();
+    forEachSeries([](const std::string& name, std::span<const double> times, std::span<const double> values) {
+        std::cout << name << "\n";
 
-            for(auto inner_element : element.second){
-                std::cout << "  " << inner_element.first << "," << inner_element.second << "\n";
-            }
+        for (std::size_t i = 0; i < times.size(); ++i) {
+            std::cout << "  " << times[i] << "," << values[i] << "\n";
         }
+    });
 }
 
 void EpitrendBinaryData::printFileAllTimeSeriesData(const Config& config, const std::string& filename){
+    finalize();
     std::string fullpath = config.getOutputDir() + filename;
     std::ofstream outFile(fullpath);
-    for(auto element : allTimeSeriesData) {
-        outFile << element.first << "\n";
+    forEachSeries([&outFile](const std::string& name, std::span<const double> times, std::span<const double> values) {
+        outFile << name << "\n";
 
-        for(auto inner_element : element.second) {
-            outFile << std::setprecision(15) << inner_element.first << "," << inner_element.second << "\n";
+        for (std::size_t i = 0; i < times.size(); ++i) {
+            outFile << std::setprecision(15) << times[i] << "," << values[i] << "\n";
 
         }
-
-    }
+    });
 }
 
 bool EpitrendBinaryData::is_empty(){
-    return allTimeSeriesData.empty();
+    return std::all_of(series_.begin(), series_.end(), [](const Series& series) { return series.times.empty(); });
 }
 
 //
 void EpitrendBinaryData::clear(){
-    allTimeSeriesData.clear();
+    name_indices_.clear();
+    names_.clear();
+    series_.clear();
+    last_sensor_ = 0;
+    finalized_ = true;
     byteSize = 0;
 }
 
 // Return the difference between two EpitrendBinaryData objects
-EpitrendBinaryData EpitrendBinaryData::difference(EpitrendBinaryData& other) const{
-    std::unordered_map<std::string, std::unordered_map<double,double>> other_data = other.getAllTimeSeriesData();
+EpitrendBinaryData EpitrendBinaryData::difference(const EpitrendBinaryData& other, bool parallel) const{
+    checkFinalized("difference");
+    other.checkFinalized("difference");
+
+    return makeDifference([this, &other](SensorIndex sensor, Series& result) {
+        const Series& series = series_[sensor];
+        auto other_it = other.name_indices_.find(names_[sensor]);
+        if (other_it == other.name_indices_.end()) {
+            result = series;
+            return;
+        }
+
+        // Walk the two sorted time vectors in step
+        const Series& other_series = other.series_[other_it->second];
+        const auto time = [](double t) { return t; };
+        sortedDifference(series.times.begin(), series.times.end(),
+            other_series.times.begin(), other_series.times.end(), time, time,
+            [&series, &result](std::vector<double>::const_iterator it) {
+                result.times.push_back(*it);
+                result.values.push_back(series.values[it - series.times.begin()]);
+            });
+    }, parallel);
+}
+
+EpitrendBinaryData EpitrendBinaryData::difference(const SeriesFingerprint& fingerprint, bool parallel) const {
+    checkFinalized("difference");
+
+    return makeDifference([this, &fingerprint](SensorIndex sensor, Series& result) {
+        const Series& series = series_[sensor];
+        fingerprintDifference(series.times.begin(), series.times.end(), [](double t) { return t; },
+            fingerprint, fingerprint.find(names_[sensor]),
+            [&series, &result](std::vector<double>::const_iterator it) {
+                result.times.push_back(*it);
+                result.values.push_back(series.values[it - series.times.begin()]);
+            });
+    }, parallel);
+}
+
+void EpitrendBinaryData::addToFingerprint(SeriesFingerprint& fingerprint) const {
+    checkFinalized("addToFingerprint");
+    for (SensorIndex sensor = 0; sensor < series_.size(); ++sensor) {
+        const Series& series = series_[sensor];
+        fingerprint.add(names_[sensor],
+            fingerprintWindows(series.times.begin(), series.times.end(), [](double t) { return t; }, fingerprint));
+    }
+}
+
+EpitrendBinaryData EpitrendBinaryData::makeDifference(
+    const std::function<void(SensorIndex sensor, Series& result)>& diff_sensor, bool parallel) const {
+    // Each sensor writes only its own result, so sensors can be diffed concurrently
+    std::vector<Series> results(series_.size());
+    parallelFor(series_.size(), parallel, [&diff_sensor, &results](std::size_t sensor) {
+        diff_sensor(static_cast<SensorIndex>(sensor), results[sensor]);
+    });
+
     EpitrendBinaryData diff_data;
-    for(auto element : allTimeSeriesData){
-        std::string name = element.first;
-        std::unordered_map<double,double> time_series = element.second;
-        for(auto inner_element : time_series){
-            double time = inner_element.first;
-            double value = inner_element.second;
-            if(other_data.find(name) == other_data.end() || other_data[name].find(time) == other_data[name].end()){
-                diff_data.addDataItem(name, std::make_pair(time, value));
-            }
+    for (SensorIndex sensor = 0; sensor < results.size(); ++sensor) {
+        if (results[sensor].times.empty()) {
+            continue;
         }
+        const SensorIndex diff_sensor_index = diff_data.internName(names_[sensor]);
+        diff_data.byteSize += static_cast<int>(results[sensor].times.size() * (16 + names_[sensor].length()));
+        diff_data.series_[diff_sensor_index] = std::move(results[sensor]);
     }
 
     return diff_data;
+}
 
+void EpitrendBinaryData::checkFinalized(const char* caller) const {
+    if (!finalized_) {
+        std::cerr << "Error in EpitrendBinaryData::" << caller << " call: data is not finalized\n";
+        throw std::runtime_error(std::string("Error in EpitrendBinaryData::") + caller + " call: data is not finalized\n");
+    }
 }
@@ -1,22 +1,45 @@
 #ifndef EPITRENDBINARYDATA_HPP
 #define EPITRENDBINARYDATA_HPP
 
+#include <cstdint>
+#include <span>
+
 #include "Common.hpp"
+#include "SeriesFingerprint.hpp"
 
+// Time-series data decoded from Epitrend binary files, stored column-wise: sensor names are interned
+// into indices, and each sensor has append-only time and value vectors. Samples are kept in the order
+// they were added until finalize() sorts them by time and drops duplicate times (the last one added wins)
 class EpitrendBinaryData {
 public:
+    using SensorIndex = std::uint32_t; // Stable for the object's lifetime, until clear()
+
     // Constructors
     EpitrendBinaryData() = default;
 
     // Setters
+    SensorIndex internName(std::string_view name); // Index of the name, added if new
     void addDataItem(
-        std::string name, 
-        std::pair<double,double> time_series, 
+        std::string_view name,
+        std::pair<double,double> time_series,
         bool verbose = false
     );
+    void addDataItem(SensorIndex sensor, std::pair<double,double> time_series); // No name lookup
+    void reserve(std::size_t sensors);
+    void reserve(SensorIndex sensor, std::size_t samples);
 
-    // Getters
-    std::unordered_map<std::string, std::unordered_map<double,double>> getAllTimeSeriesData();
+    // Sort every sensor's samples by time and drop duplicate times. Readers below expect finalized data;
+    // adding samples afterwards requires another call
+    void finalize(bool verbose = false);
+    bool is_finalized() const;
+
+    // Getters. The spans stay valid until the data is modified
+    std::size_t getSensorCount() const;
+    const std::string& getName(SensorIndex sensor) const;
+    std::span<const double> getTimes(SensorIndex sensor) const; // Days from epoch, sorted once finalized
+    std::span<const double> getValues(SensorIndex sensor) const;
+    void forEachSeries(const std::function<void(const std::string& name,
+        std::span<const double> times, std::span<const double> values)>& visitor) const;
     int getByteSize();
 
     // Utility Methods
@@ -27,12 +50,40 @@ public:
     // Clear all contents of time-series data
     void clear();
 
-    // Difference between two EpitrendBinaryData objects
-    EpitrendBinaryData difference(EpitrendBinaryData& other) const;
+    // Difference between two EpitrendBinaryData objects: the samples whose time the other object does not
+    // have for the same sensor. Both must be finalized. With parallel, sensors are diffed concurrently
+    EpitrendBinaryData difference(const EpitrendBinaryData& other, bool parallel = false) const;
+
+    // The samples that are not in the bucket yet according to the fingerprint (see fingerprintDifference),
+    // and recording samples as uploaded. Must be finalized
+    constexpr static double FINGERPRINT_WINDOW = 1.0 / 24; // One hour, in days
+    EpitrendBinaryData difference(const SeriesFingerprint& fingerprint, bool parallel = false) const;
+    void addToFingerprint(SeriesFingerprint& fingerprint) const;
 
 
 private:
-    std::unordered_map<std::string, std::unordered_map<double,double>> allTimeSeriesData;
+    struct Series {
+        std::vector<double> times;
+        std::vector<double> values;
+    };
+
+    // Transparent hashing so names can be looked up from a string_view without a copy
+    struct NameHash {
+        using is_transparent = void;
+        std::size_t operator()(std::string_view name) const { return std::hash<std::string_view>{}(name); }
+    };
+
+    // Build a difference from the samples diff_sensor(sensor, result) leaves in result for every sensor.
+    // Sensors left without samples are dropped
+    EpitrendBinaryData makeDifference(
+        const std::function<void(SensorIndex sensor, Series& result)>& diff_sensor, bool parallel) const;
+    void checkFinalized(const char* caller) const;
+
+    std::unordered_map<std::string, SensorIndex, NameHash, std::equal_to<>> name_indices_;
+    std::vector<std::string> names_; // Indexed by SensorIndex
+    std::vector<Series> series_; // Indexed by SensorIndex
+    SensorIndex last_sensor_ = 0; // Decoders add runs of samples of one sensor, so check it before hashing
+    bool finalized_ = true;
     int byteSize = 0;
 };
 
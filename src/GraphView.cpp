@@ -49,6 +49,14 @@ void GraphView::setUpdateRangeCallback(UpdateRangeCallback callback) {
     update_range_callback_ = callback;
 }
 
+void GraphView::setSpectrogramRangeCallback(SpectrogramRangeCallback callback) {
+    spectrogram_range_callback_ = callback;
+}
+
+void GraphView::setSpectrogramRemovedCallback(SpectrogramRemovedCallback callback) {
+    spectrogram_removed_callback_ = callback;
+}
+
 
 
 
@@ -148,6 +156,13 @@ void GraphView::actionSubmitAddPlotPopup(AddPlotPopupState& state) {
 
     plot.setPlotRange(start, end);
 
+    // A spectrogram shows all RGA bins, not the selected sensors
+    if (state.is_spectrogram) {
+        plot.setPlotType(RenderablePlot::PlotType::Spectrogram);
+        window.addRenderablePlot(state.plot_label, std::make_unique<RenderablePlot>(std::move(plot)));
+        return;
+    }
+
     // Add selected sensors to the plot
     for (const auto& sensor : state.selected_sensors) {
         plot.setData(sensor, {});
@@ -895,18 +910,24 @@ void GraphView::renderAllPlotsInWindow(WindowPlots* window) {
         // Create a button to open the plot options popup
         renderPlotOptions(("###" + renderable_plot.getLabel()), renderable_plot);
 
+        if (renderable_plot.getPlotType() == RenderablePlot::PlotType::Spectrogram) {
+            renderSpectrogramPlot(renderable_plot, plot_start, plot_end);
+            ImGui::Separator();
+            continue;
+        }
+
         // Render the plot
         if (ImPlot::BeginPlot(("###" + renderable_plot.getLabel()).c_str(), nullptr, nullptr, ImVec2(-1, 250 * g_scale))) {
             // Get all sensors in the plot
-            const std::vector<std::string> sensors = renderable_plot.getAllSensors();
+            const std::vector<SensorHandle> sensors = renderable_plot.getAllSensorHandles();
 
             // Set up the plot Y-axis before any setup locking functions
-            for (const auto& series_label : sensors) {
+            for (SensorHandle sensor : sensors) {
                 // Get the axis (Y1, Y2, Y3) for the sensor
-                ImAxis plot_axis = renderable_plot.getYAxisForSensor(series_label);
+                ImAxis plot_axis = renderable_plot.getYAxisForSensor(sensor);
                 ImPlot::SetupAxis(plot_axis, nullptr, ImPlotAxisFlags_AuxDefault);
                 if (renderable_plot.getYAxisPropertiesUserSetRange(plot_axis)) {
-                    std::cout << "Setting axis limits for " << series_label << " to " << renderable_plot.getYAxisPropertiesMin(plot_axis)
+                    std::cout << "Setting axis limits for " << SensorRegistry::getLabel(sensor) << " to " << renderable_plot.getYAxisPropertiesMin(plot_axis)
                         << " - " << renderable_plot.getYAxisPropertiesMax(plot_axis) << "\n";
                     ImPlot::SetupAxisLimits(plot_axis, renderable_plot.getYAxisPropertiesMin(plot_axis),
                         renderable_plot.getYAxisPropertiesMax(plot_axis), ImGuiCond_Always);
@@ -944,28 +965,27 @@ void GraphView::renderAllPlotsInWindow(WindowPlots* window) {
             }
 
             ImPlotRect limits = ImPlot::GetPlotLimits();
-            double range = limits.X.Max - limits.X.Min;
-            int num_pixels = ImPlot::GetPlotPos().x + ImPlot::GetPlotSize().x;
+            int plot_width_px = static_cast<int>(ImPlot::GetPlotSize().x);
 
             // Plot all sensors
-            for (const auto& series_label : sensors) {
-                // Get downsampled data
-                auto [xs, ys] = viewModel_.getDownsampledData(renderable_plot, series_label, range, num_pixels);
+            for (SensorHandle sensor : sensors) {
+                // Get downsampled data (aggregated per pixel column of the plot)
+                const DownsampledSeries& downsampled = viewModel_.getDownsampledData(
+                    renderable_plot, sensor, limits.X.Min, limits.X.Max, plot_width_px);
 
-                // Apply the plotline properties
+                // Apply the plotline properties (looked up once per series)
+                const RenderablePlot::PlotLineProperties& line_properties = renderable_plot.getPlotLineProperties(sensor);
                 // Line colour
-                ImPlot::SetNextLineStyle(renderable_plot.getPlotLineProperties(series_label).colour);
+                ImPlot::SetNextLineStyle(line_properties.colour);
 
                 // Marker style
-                ImPlot::SetNextMarkerStyle(renderable_plot.getPlotLineProperties(series_label).marker_style,
-                    renderable_plot.getPlotLineProperties(series_label).marker_size,
-                    renderable_plot.getPlotLineProperties(series_label).fill, renderable_plot.getPlotLineProperties(series_label).fill_weight,
-                    renderable_plot.getPlotLineProperties(series_label).fill_outline);
+                ImPlot::SetNextMarkerStyle(line_properties.marker_style, line_properties.marker_size,
+                    line_properties.fill, line_properties.fill_weight, line_properties.fill_outline);
 
                 // Get the axis (Y1, Y2, Y3) for the sensor
-                ImAxis plot_axis = renderable_plot.getYAxisForSensor(series_label);
+                ImAxis plot_axis = renderable_plot.getYAxisForSensor(sensor);
                 ImPlot::SetAxes(ImAxis_X1, plot_axis);
-                ImPlot::PlotStairs(series_label.c_str(), xs.data(), ys.data(), xs.size());
+                ImPlot::PlotStairs(SensorRegistry::getLabel(sensor).c_str(), downsampled.xs.data(), downsampled.ys.data(), downsampled.xs.size());
             }
 
             // Callback plot range
@@ -977,8 +997,10 @@ void GraphView::renderAllPlotsInWindow(WindowPlots* window) {
             // Callback to update the range in the data manager
             if (update_range_callback_) {
                 // Update the range for all sensors in the plot
-                for (const auto& sensor : sensors) {
-                    update_range_callback_(sensor, renderable_plot.getPlotId(), limits.X.Min, limits.X.Max);
+                const SensorTimestamp range_start = secondsToTimestamp(limits.X.Min);
+                const SensorTimestamp range_end = secondsToTimestamp(limits.X.Max);
+                for (SensorHandle sensor : sensors) {
+                    update_range_callback_(sensor, renderable_plot.getPlotId(), range_start, range_end);
                 }
             }
 
@@ -986,7 +1008,7 @@ void GraphView::renderAllPlotsInWindow(WindowPlots* window) {
             for (const auto& axis : {ImAxis_Y1, ImAxis_Y2, ImAxis_Y3}) {
                 // Check if the axis exists in the plot
                 bool axis_exists = false;
-                for (const auto& sensor: sensors) {
+                for (SensorHandle sensor : sensors) {
                     if (renderable_plot.getYAxisForSensor(sensor) == axis) {
                         axis_exists = true;
                         break;
@@ -1013,6 +1035,49 @@ void GraphView::renderAllPlotsInWindow(WindowPlots* window) {
     }
 }
 
+// Render the time x AMU image of all RGA bins. The image has a few cells per pixel column whatever the
+// range, so zooming out to months costs the same as a few minutes
+void GraphView::renderSpectrogramPlot(RenderablePlot& renderable_plot, std::time_t plot_start, std::time_t plot_end) {
+    if (!ImPlot::BeginPlot(("###" + renderable_plot.getLabel()).c_str(), nullptr, nullptr, ImVec2(-1, 250 * g_scale))) {
+        return;
+    }
+    const double amu_min = RGAData::MIN_UNIT - 0.5;
+    const double amu_max = RGAData::MAX_UNIT + 0.5;
+    ImPlot::SetupAxis(ImAxis_Y1, "AMU");
+    ImPlot::SetupAxisLimits(ImAxis_Y1, amu_min, amu_max, ImGuiCond_Once);
+
+    // Set the plot X_axis to time
+    ImPlot::SetupAxisScale(ImAxis_X1, ImPlotScale_Time);
+    if(renderable_plot.isRealTime()){
+        ImPlot::SetupAxisLimits(ImAxis_X1, plot_start, plot_end, ImGuiCond_Always);
+    } else {
+        ImPlot::SetupAxisLimits(ImAxis_X1, plot_start, plot_end, ImGuiCond_Once);
+    }
+
+    ImPlotRect limits = ImPlot::GetPlotLimits();
+    int plot_width_px = static_cast<int>(ImPlot::GetPlotSize().x);
+
+    const SpectrogramImage& image = viewModel_.getSpectrogramImage(renderable_plot, limits.X.Min, limits.X.Max, plot_width_px);
+    if (image.columns > 0) {
+        ImPlot::PushColormap(ImPlotColormap_Viridis);
+        ImPlot::PlotHeatmap("log10 max", image.values.data(), static_cast<int>(image.rows), static_cast<int>(image.columns),
+            image.scale_min, image.scale_max, nullptr, ImPlotPoint(image.start, amu_min), ImPlotPoint(image.end, amu_max));
+        ImPlot::PopColormap();
+    }
+
+    // Callback plot range
+    renderable_plot.notifyRangeChange(limits.X.Min, limits.X.Max);
+
+    // Update the plot range
+    renderable_plot.setPlotRange(limits.X.Min, limits.X.Max);
+
+    // Callback to fetch the tiles of the range in the data manager
+    if (spectrogram_range_callback_) {
+        spectrogram_range_callback_(static_cast<int>(renderable_plot.getPlotId()), limits.X.Min, limits.X.Max, plot_width_px);
+    }
+    ImPlot::EndPlot();
+}
+
 // Render menu bar for the window
 void GraphView::renderWindowMenuBar(WindowPlots* window) {
     // Get the file menu state
@@ -2308,6 +2373,8 @@ void GraphView::renderWindowPlotAddPlotPopup(WindowPlots *window){
                 // Real-time plotting checkbox
         ImGui::Checkbox("Real-time", &window_plot_add_plot_popup_state.is_real_time);
         is_able_to_submit = window_plot_add_plot_popup_state.is_real_time;
+        ImGui::SameLine();
+        ImGui::Checkbox("RGA spectrogram", &window_plot_add_plot_popup_state.is_spectrogram);
 
         // Real-time plot range
         if(window_plot_add_plot_popup_state.is_real_time && !window_plot_add_plot_popup_state.is_range_initialized) {
@@ -2441,6 +2508,14 @@ void GraphView::renderAllWindowPlots(){
         ImGui::End();
 
     }
+
+    // Drop render cache entries of plots and sensors that were not drawn this frame, and stop fetching
+    // spectrogram tiles for plots that are gone
+    for (long long plot_id : viewModel_.pruneDownsampleCache()) {
+        if (spectrogram_removed_callback_) {
+            spectrogram_removed_callback_(static_cast<int>(plot_id));
+        }
+    }
 }
 
 
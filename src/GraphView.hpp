@@ -24,11 +24,21 @@ public:
     // ==============================
     // renderAddPlotPopup
     // ==============================
-    using UpdateRangeCallback = std::function<void(const std::string& sensor_id, int plot_id, double start, double end)>;
+    using UpdateRangeCallback = std::function<void(SensorHandle sensor, int plot_id, SensorTimestamp start, SensorTimestamp end)>;
     void setUpdateRangeCallback(UpdateRangeCallback callback);
 
+    // Visible range (plot seconds) and width in pixels of a spectrogram plot, reported every frame
+    using SpectrogramRangeCallback = std::function<void(int plot_id, double start, double end, int pixel_width)>;
+    void setSpectrogramRangeCallback(SpectrogramRangeCallback callback);
+
+    // A spectrogram plot was removed (or stopped showing the spectrogram)
+    using SpectrogramRemovedCallback = std::function<void(int plot_id)>;
+    void setSpectrogramRemovedCallback(SpectrogramRemovedCallback callback);
+
 private:
     UpdateRangeCallback update_range_callback_;
+    SpectrogramRangeCallback spectrogram_range_callback_;
+    SpectrogramRemovedCallback spectrogram_removed_callback_;
     GraphViewModel& viewModel_;
 
     // ==============================
@@ -62,6 +72,7 @@ private:
         const std::string& popup_label, RenderablePlot& renderable_plot
     );
     void renderAllPlotsInWindow(WindowPlots* window);
+    void renderSpectrogramPlot(RenderablePlot& renderable_plot, std::time_t plot_start, std::time_t plot_end);
     void renderWindowMenuBar(WindowPlots* window);
     void renderAllWindowPlots();
 
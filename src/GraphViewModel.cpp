@@ -1,7 +1,12 @@
 #include <iostream>
 #include <cmath>
+#include <iterator>
+#include <set>
+#include <limits>
+#include <algorithm>
 
 #include "GraphViewModel.hpp"
+#include "m4.hpp"
 
 GraphViewModel::GraphViewModel(std::mutex& mutex)
     : update_viewModel_mutex_(mutex) {}
@@ -23,6 +28,8 @@ PlotOptionsPopupState& GraphViewModel::getPlotOptionsState(){
 }
 
 void GraphViewModel::updatePlotsWithData(DataManager& dataManager) {
+    std::set<std::pair<long long, SensorHandle>> visited_series;
+
     // Loop through all windows and renderable plots
     for (auto& window_plot_label : getWindowPlotLabels()) {
         WindowPlots& window_plot = getWindowPlot(window_plot_label);
@@ -30,67 +37,184 @@ void GraphViewModel::updatePlotsWithData(DataManager& dataManager) {
         // Loop through all renderable plots in the window
         for (auto& renderable_plot_labels: window_plot.getRenderablePlotLabels()) {
             RenderablePlot& renderable_plot = window_plot.getRenderablePlot(renderable_plot_labels);
+            const DataManager::Timestamp range_start = secondsToTimestamp(renderable_plot.getPlotRange().first);
+            const DataManager::Timestamp range_end = secondsToTimestamp(renderable_plot.getPlotRange().second);
 
             // Update the data for all sensors in the plot
-            for (const auto& sensor: renderable_plot.getAllSensors()) {
-                std::vector<std::pair<DataManager::Timestamp, DataManager::Value>> data_in_range
-                 = dataManager.getBuffersSnapshot(
-                    sensor, renderable_plot.getPlotRange().first, renderable_plot.getPlotRange().second);
-
-                renderable_plot.setData(sensor, data_in_range);
+            for (SensorHandle sensor: renderable_plot.getAllSensorHandles()) {
+                // Skip the copy if neither the buffer, the plot's series nor the range changed since the last fetch
+                const std::uint64_t buffer_version = dataManager.getBufferVersion(sensor);
+                visited_series.insert({renderable_plot.getPlotId(), sensor});
+                DataFetchKey& last_fetch = last_data_fetch_[{renderable_plot.getPlotId(), sensor}];
+                if (last_fetch.buffer_version == buffer_version &&
+                    last_fetch.plot_data_version == renderable_plot.getDataVersion(sensor) &&
+                    last_fetch.start == range_start && last_fetch.end == range_end) {
+                    continue;
+                }
+
+                renderable_plot.setData(sensor, dataManager.getRangeView(sensor, range_start, range_end));
+
+                last_fetch = {
+                    .buffer_version = buffer_version,
+                    .plot_data_version = renderable_plot.getDataVersion(sensor),
+                    .start = range_start,
+                    .end = range_end
+                };
             }
 
         }
     }
+
+    // Forget fetches of plots and sensors that were removed
+    for (auto it = last_data_fetch_.begin(); it != last_data_fetch_.end();) {
+        if (visited_series.find(it->first) == visited_series.end()) {
+            it = last_data_fetch_.erase(it);
+        } else {
+            ++it;
+        }
+    }
 }
 
-std::pair<std::vector<DataManager::Timestamp>, std::vector<DataManager::Value>> GraphViewModel::getDownsampledData(
-    RenderablePlot& plot, const std::string& sensor, double range, int num_pixels) {
-    std::vector<DataManager::Timestamp> timestamps;
-    std::vector<DataManager::Value> values;
-    RenderablePlot::DataSeries data = plot.getDataSnapshot(sensor);
+const DownsampledSeries& GraphViewModel::getDownsampledData(
+    RenderablePlot& plot, SensorHandle sensor, double x_min, double x_max, int pixel_width) {
+    // Check if the axis for this sensor is log scale
+    ImAxis axis = plot.getYAxisForSensor(sensor);
+    bool is_log = plot.getYAxisPropertiesScaleType(axis) == RenderablePlot::ScaleType::Logirithmic;
+
+    // Return the cached series if nothing changed since it was computed
+    const std::uint64_t data_version = plot.getDataVersion(sensor);
+    DownsampleCacheEntry& entry = downsample_cache_[{plot.getPlotId(), sensor}];
+    entry.last_used_frame = render_frame_;
+    if (entry.data_version == data_version && data_version != 0 &&
+        entry.x_min == x_min && entry.x_max == x_max &&
+        entry.pixel_width == pixel_width && entry.is_log == is_log) {
+        return entry.series;
+    }
+
+    entry.data_version = data_version;
+    entry.x_min = x_min;
+    entry.x_max = x_max;
+    entry.pixel_width = pixel_width;
+    entry.is_log = is_log;
+    entry.series.xs.clear();
+    entry.series.ys.clear();
+
+    // View of the visible slice of the series (plus one neighbour on each side)
+    const DataManager::Timestamp start = secondsToTimestamp(x_min);
+    const DataManager::Timestamp end = secondsToTimestamp(x_max);
+    RenderablePlot::DataSeries data = plot.getDataSnapshot(sensor, start, end);
 
     // If there is no data for the sensor, return empty vectors
     if (data.empty()) {
-        return {timestamps, values};
+        return entry.series;
     }
 
-    // Calculate the step size based on the range and number of pixels
-    int step_size = static_cast<int>(range / num_pixels / 10);
-    if (step_size <= 0) {
-        step_size = 1;
+    // Aggregate into at most four points per pixel column
+    const std::size_t columns = static_cast<std::size_t>(std::max(pixel_width, 1));
+    std::vector<std::pair<DataManager::Timestamp, DataManager::Value>> aggregated;
+    aggregated.reserve(4 * columns + 2);
+
+    using Point = std::pair<DataManager::Timestamp, DataManager::Value>;
+    M4Aggregation<Point, DataManager::Timestamp, DataManager::Value, &Point::first, &Point::second>::Downsample(
+        data.begin(), data.end(), static_cast<double>(start), static_cast<double>(end), columns, std::back_inserter(aggregated),
+        [is_log](const Point& point) {
+            return !is_log || point.second > 0; // Only include positive values for log scale
+        });
+
+    // Split into the x (seconds) and y arrays expected by ImPlot
+    entry.series.xs.reserve(aggregated.size());
+    entry.series.ys.reserve(aggregated.size());
+    for (const auto& [ts, val] : aggregated) {
+        entry.series.xs.push_back(timestampToSeconds(ts));
+        entry.series.ys.push_back(static_cast<double>(val));
     }
 
-    // Calculate how many points we need to render based on the step size
-    int num_points_to_render = data.size() / step_size;
-    if (num_points_to_render <= 0) {
-        num_points_to_render = data.size();
+    return entry.series;
+}
+
+std::vector<long long> GraphViewModel::pruneDownsampleCache() {
+    // Entries that were not requested during this frame belong to removed (or hidden) plots and sensors
+    for (auto it = downsample_cache_.begin(); it != downsample_cache_.end();) {
+        if (it->second.last_used_frame != render_frame_) {
+            it = downsample_cache_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    std::vector<long long> removed_spectrograms;
+    for (auto it = spectrogram_images_.begin(); it != spectrogram_images_.end();) {
+        if (it->second.last_used_frame != render_frame_) {
+            removed_spectrograms.push_back(it->first);
+            it = spectrogram_images_.erase(it);
+        } else {
+            ++it;
+        }
     }
+    ++render_frame_;
+    return removed_spectrograms;
+}
 
-    // Reserve space for the timestamps and values to avoid multiple reallocations
-    timestamps.reserve(num_points_to_render);
-    values.reserve(num_points_to_render);
+void GraphViewModel::setSpectrogramCache(std::shared_ptr<SpectrogramCache> cache) {
+    spectrogram_cache_ = std::move(cache);
+}
 
-    // Check if the axis for this sensor is log scale
-    ImAxis axis = plot.getYAxisForSensor(sensor);
-    bool is_log = plot.getYAxisPropertiesScaleType(axis) == RenderablePlot::ScaleType::Logirithmic;
+const SpectrogramImage& GraphViewModel::getSpectrogramImage(
+    RenderablePlot& plot, double x_min, double x_max, int pixel_width) {
+    SpectrogramCacheEntry& entry = spectrogram_images_[plot.getPlotId()];
+    entry.last_used_frame = render_frame_;
+    if (!spectrogram_cache_) {
+        return entry.image;
+    }
 
-    // Iterate through the data and downsample it
-    int counter = 0;
-    int data_pos = 0;
-    for (int i = 0;
-        i < num_points_to_render && data_pos < data.size();
-        ++i, data_pos += step_size) {
-        auto ts = data.at(data_pos).first;
-        auto val = data.at(data_pos).second;
-        if (!is_log || val > 0) { // Only include positive values for log scale
-            timestamps.push_back(ts);
-            values.push_back(val);
-            counter++;
+    // Return the cached image if nothing changed since it was built
+    const std::uint64_t cache_version = spectrogram_cache_->getVersion();
+    if (entry.cache_version == cache_version && cache_version != 0 &&
+        entry.x_min == x_min && entry.x_max == x_max && entry.pixel_width == pixel_width) {
+        return entry.image;
+    }
+    entry.cache_version = cache_version;
+    entry.x_min = x_min;
+    entry.x_max = x_max;
+    entry.pixel_width = pixel_width;
+
+    // At most a few cells per pixel column, whatever the number of samples in the range
+    const int level = SpectrogramCache::chooseLevel(x_min, x_max, pixel_width);
+    const SpectrogramCache::Image cells = spectrogram_cache_->getImage(level, x_min, x_max);
+
+    SpectrogramImage& image = entry.image;
+    image.rows = cells.rows;
+    image.columns = cells.columns;
+    image.start = cells.start;
+    image.end = cells.end;
+    image.values.resize(cells.values.size());
+
+    // Partial pressures span decades, so colour by log10. Flip the rows so the highest AMU is drawn on top
+    double scale_min = std::numeric_limits<double>::infinity();
+    double scale_max = -std::numeric_limits<double>::infinity();
+    for (std::size_t row = 0; row < cells.rows; ++row) {
+        const double* source = cells.values.data() + row * cells.columns;
+        double* target = image.values.data() + (cells.rows - 1 - row) * cells.columns;
+        for (std::size_t column = 0; column < cells.columns; ++column) {
+            const double value = source[column] > 0 ? std::log10(source[column]) : std::nan("");
+            target[column] = value;
+            if (!std::isnan(value)) {
+                scale_min = std::min(scale_min, value);
+                scale_max = std::max(scale_max, value);
+            }
         }
     }
+    if (scale_min > scale_max) {
+        scale_min = 0; // No samples in the range
+        scale_max = 1;
+    } else if (scale_min == scale_max) {
+        scale_max = scale_min + 1;
+    }
+    image.scale_min = scale_min;
+    image.scale_max = scale_max;
 
-    return {timestamps, values};
+    // ImPlot does not skip NaN cells, so draw empty ones in the lowest colour
+    std::replace_if(image.values.begin(), image.values.end(), [](double value) { return std::isnan(value); }, scale_min);
+    return image;
 }
 
 
@@ -120,6 +120,7 @@ struct PlotOptionsPopupState {
 struct WindowPlotAddPlotPopupState {
     std::string plot_label;
     bool is_real_time = true;
+    bool is_spectrogram = false;
     std::vector<std::string> all_sensors;
     std::vector<std::string> available_sensors;
     std::vector<std::string> selected_sensors;
@@ -149,6 +150,7 @@ struct WindowPlotAddPlotPopupState {
     void reset() {
         plot_label.clear();
         is_real_time = true;
+        is_spectrogram = false;
         all_sensors.clear();
         available_sensors.clear();
         selected_sensors.clear();
@@ -324,6 +326,24 @@ struct LoadWindowState {
     }
 };
 
+// Downsampled series ready to be handed to ImPlot. xs are in seconds
+struct DownsampledSeries {
+    std::vector<double> xs;
+    std::vector<double> ys;
+};
+
+// Spectrogram cells ready to be handed to ImPlot::PlotHeatmap: log10 of the max in each cell, first row
+// the highest AMU. Empty cells hold scale_min
+struct SpectrogramImage {
+    std::size_t rows = 0;
+    std::size_t columns = 0;
+    double start = 0; // Seconds
+    double end = 0;
+    double scale_min = 0;
+    double scale_max = 1;
+    std::vector<double> values;
+};
+
 class GraphViewModel {
 public:
     // Constructor
@@ -342,9 +362,20 @@ public:
     // Update plots with data from DataManager
     void updatePlotsWithData(DataManager& dataManager);
 
-    // Get downsampled data for a specific sensor
-    std::pair<std::vector<DataManager::Timestamp>, std::vector<DataManager::Value>> getDownsampledData(
-    RenderablePlot& plot, const std::string& sensor, double range, int num_pixels);
+    // Get M4-downsampled data for a specific sensor over the visible x-range and plot width in pixels.
+    // The result is cached per (plot, sensor) and only recomputed when the data version, visible range,
+    // pixel width or log-scale flag changes. The reference is valid until the next call for the same series.
+    const DownsampledSeries& getDownsampledData(
+    RenderablePlot& plot, SensorHandle sensor, double x_min, double x_max, int pixel_width);
+
+    // Drop cached downsampled series and spectrogram images that were not requested this frame. Call once
+    // at the end of each frame. Returns the ids of the plots whose spectrogram image was dropped
+    std::vector<long long> pruneDownsampleCache();
+
+    // Spectrogram of all RGA bins over the visible x-range, at the level matching the plot width in pixels.
+    // Cached per plot and only rebuilt when the range, width or cached tiles change. Same validity as above
+    void setSpectrogramCache(std::shared_ptr<SpectrogramCache> cache);
+    const SpectrogramImage& getSpectrogramImage(RenderablePlot& plot, double x_min, double x_max, int pixel_width);
 
 
 
@@ -388,6 +419,40 @@ private:
     // "Plot options" popup state
     PlotOptionsPopupState plot_options_popup_state_;
 
+    // Render cache for downsampled series, keyed by (plot id, sensor). Only used by the render thread
+    struct DownsampleCacheEntry {
+        std::uint64_t data_version = 0;
+        double x_min = 0;
+        double x_max = 0;
+        int pixel_width = 0;
+        bool is_log = false;
+        std::uint64_t last_used_frame = 0;
+        DownsampledSeries series;
+    };
+    std::map<std::pair<long long, SensorHandle>, DownsampleCacheEntry> downsample_cache_;
+    std::uint64_t render_frame_ = 0;
+
+    // Render cache for spectrogram images, keyed by plot id. Only used by the render thread
+    struct SpectrogramCacheEntry {
+        std::uint64_t cache_version = 0;
+        double x_min = 0;
+        double x_max = 0;
+        int pixel_width = 0;
+        std::uint64_t last_used_frame = 0;
+        SpectrogramImage image;
+    };
+    std::shared_ptr<SpectrogramCache> spectrogram_cache_;
+    std::map<long long, SpectrogramCacheEntry> spectrogram_images_;
+
+    // Last fetch from the DataManager, keyed by (plot id, sensor). Only used by the update thread
+    struct DataFetchKey {
+        std::uint64_t buffer_version = 0;
+        std::uint64_t plot_data_version = 0;
+        DataManager::Timestamp start = 0;
+        DataManager::Timestamp end = 0;
+    };
+    std::map<std::pair<long long, SensorHandle>, DataFetchKey> last_data_fetch_;
+
 
 
     // ============================================
@@ -353,6 +353,58 @@ std::vector<std::unordered_map<std::string,std::string>> InfluxDatabase::parseQu
 }
 
 
+// Parse the CSV response into rows allocated from the arena. Same format and checks as above
+std::pmr::vector<InfluxDatabase::QueryRow> InfluxDatabase::parseQueryResponseInto(
+    const std::string& response, std::pmr::memory_resource* arena, bool verbose) {
+    std::pmr::vector<QueryRow> out(arena);
+
+    // Cells are views into the response, so only the stored keys and values are copied (into the arena)
+    std::pmr::vector<std::string_view> headers(arena);
+    std::pmr::vector<std::string_view> entries(arena);
+
+    std::string_view remaining(response);
+    bool header_line = true;
+    while (!remaining.empty()) {
+        std::size_t line_end = remaining.find('\n');
+        std::string_view line = remaining.substr(0, line_end);
+        remaining.remove_prefix(line_end == std::string_view::npos ? remaining.size() : line_end + 1);
+
+        // Trim the trailing whitespace
+        while (!line.empty() && std::isspace(static_cast<unsigned char>(line.back()))) {
+            line.remove_suffix(1);
+        }
+
+        // Parse headers (first line)
+        if (header_line) {
+            if(verbose) std::cout << "Line :" << line << "\n";
+            split(line, ',', headers);
+            header_line = false;
+            if(verbose) for(auto element : headers) {std::cout << "header|" << element << "|\n"; }
+            continue;
+        }
+
+        // Parse rows
+        if (line.empty()) continue;
+        if(verbose) std::cout << "Current line:|" << line << "|\n";
+        split(line, ',', entries);
+        if(verbose) for(auto element : entries) {std::cout << "entry|" << element << "|\n";}
+
+        if(entries.size() != headers.size()) {
+            std::cerr << "Error in InfluxDatabase::parseQueryResponseInto call: number of headers does not match number of entries\n";
+            throw std::runtime_error("Error in InfluxDatabase::parseQueryResponseInto call: number of headers does not match number of entries\n");
+        }
+
+        QueryRow& row = out.emplace_back();
+        row.reserve(headers.size());
+        for(std::size_t i = 0; i < entries.size(); i++) {
+            row.emplace(std::pmr::string(headers[i], arena), std::pmr::string(entries[i], arena));
+        }
+    }
+
+    return out;
+}
+
+
 // Internal using of splitting by delimiter
 std::vector<std::string> InfluxDatabase::split(std::string s, const std::string& delimiter) {
     std::vector<std::string> tokens;
@@ -368,6 +420,17 @@ std::vector<std::string> InfluxDatabase::split(std::string s, const std::string&
     return tokens;
 }
 
+// Internal splitting by delimiter into views of s (no copies)
+void InfluxDatabase::split(std::string_view s, char delimiter, std::pmr::vector<std::string_view>& tokens) {
+    tokens.clear();
+    std::size_t pos;
+    while ((pos = s.find(delimiter)) != std::string_view::npos) {
+        tokens.push_back(s.substr(0, pos));
+        s.remove_prefix(pos + 1);
+    }
+    tokens.push_back(s);
+}
+
 // Internal trim function
 std::string InfluxDatabase::trimInternal(const std::string& str) {
         std::string trimmed = str;
@@ -445,158 +508,36 @@ bool InfluxDatabase::copyEpitrendToBucket(EpitrendBinaryData data, bool verbose)
     //measurement + ",sensor_id_=1 num=299i 1735728000000";
     struct ts_write_struct {
         std::string sensor_id;
-        std::string num;  // MUST BE A DECIMAL
-        std::string timestamp;
-        std::string write_query;
+        std::string num = "";  // MUST BE A DECIMAL
+        std::string timestamp = "";
+        std::string write_query = "";
         void set_write_query(){write_query ="ts,sensor_id_=" +
             sensor_id + " num=" +
             num + " " + timestamp;
         }
     };
 
-    // Prepare name-series (ns) query write statement e.g.
-    //measurement + ",machine_=\"machine.name.2\",sensor_=\"sensor.name.2\" sensor_id=\"4\" " + std::to_string(default_ns_timestamp);
-    struct ns_write_struct {
-        std::string machine_name;
-        std::string sensor_name;
-        std::string sensor_id;
-        std::string default_timestamp = "2000000000000";
-        std::string write_query;
-        void set_write_query(){write_query = "ns,machine_=" + escapeSpecialChars(machine_name) +
-            ",sensor_=" + escapeSpecialChars(sensor_name) +
-            " sensor_id=\"" + sensor_id +
-            "\" " + default_timestamp;
-        }
-    };
-
-    // Prepare name-series (ns) query read statement
-    //     "from(bucket: \"test-bucket\")"
-    //   "|> range(start: -100y, stop: 50y)"
-    //   "|> filter(fn: (r) => r[\"_measurement\"] == \"ns\")"
-    ;
-    struct ns_read_struct {
-        std::string bucket;
-        std::string machine_name;
-        std::string sensor_name;
-        std::string read_query;
-        void set_read_query(){read_query = "from(bucket: \"" + bucket + "\") "
-            "|> range(start: -50y, stop: 100y)"
-            "|> filter(fn: (r) => r[\"_measurement\"] == \"ns\")"
-            "|> filter(fn: (r) => r[\"sensor_\"] == \"" + sensor_name + "\")"
-            "|> filter(fn: (r) => r[\"machine_\"] == \"" + machine_name + "\")";
-        }
-    };
-
-    // Prepare name-series (ns) query read all data statement
-    struct ns_read_all_struct {
-        std::string bucket;
-        std::string read_query;
-        void set_read_query(){read_query = "from(bucket: \"" + bucket + "\") "
-            "|> range(start: -50y, stop: 100y)"
-            "|> filter(fn: (r) => r[\"_measurement\"] == \"ns\")";
-        }
-    };
+    // Resolve the sensor ids of all names with one read of the ns table, then add the new names to it in one batch
+    data.finalize(verbose);
+    SensorIdResolver resolver = loadSensorIdResolver(verbose);
+    for(EpitrendBinaryData::SensorIndex sensor = 0; sensor < data.getSensorCount(); ++sensor) {
+        resolver.resolve(data.getName(sensor), epitrend_machine_name);
+    }
+    writeNewSensors(resolver, verbose);
 
     // Loop through all data
-    std::unordered_map<std::string, std::unordered_map<double,double>> raw_data = data.getAllTimeSeriesData();
-    for(const auto& name_data_map : raw_data) {
-        // CHECK IF PART NAME IS IN NS TABLE
-        // IF IT ISN'T
-            // ADD ENTRY OF MACHINE NAME AND PART NAME INTO TABLE
-            // GET NEW SENSOR_ID FOR NAME AND ALSO INTO TABLE
-        // IF IT IS
-            // GET THE SENSOR_ID
-        // ENTER ALL ASSOCIATED DATA INTO TS TABLE WITH ASSOCIATE SENSOR ID
+    for(EpitrendBinaryData::SensorIndex sensor = 0; sensor < data.getSensorCount(); ++sensor) {
+        const std::string& name = data.getName(sensor);
+        const std::span<const double> times = data.getTimes(sensor);
+        const std::span<const double> values = data.getValues(sensor);
 
         if(verbose)
             std::cout << "--------------------\n Current name: " <<
-            name_data_map.first << "\n";
-
-        // Set the ns read query
-        ns_read_struct ns_read =
-        {
-            .bucket = bucket_,
-            .machine_name = epitrend_machine_name,
-            .sensor_name = name_data_map.first
-        };
-        ns_read.set_read_query();
-
-        // Query the ns table
-        std::string response;
-        queryData2(response, ns_read.read_query);
-
-        // Parse the response
-        std::vector<std::unordered_map<std::string,std::string>> parsed_response = parseQueryResponse(response);
-
-        // Prepare the sensor id associated with the current sensor name
-        int valid_sensor_id = -1;
-
-        // Check if data is found
-        if(parsed_response.size() == 0) {
-            if(verbose) std::cout << "No entry found for sensor: " << name_data_map.first << "\n";
-
-            // Set the ns read all data query
-            ns_read_all_struct ns_read_all = {.bucket = bucket_};
-            ns_read_all.set_read_query();
-
-            // Query the ns table for all data
-            response = "";
-            queryData2(response, ns_read_all.read_query);
-
-            if(verbose) std::cout << "Query: " << ns_read_all.read_query << "\n";
-            if(verbose) std::cout << "Response: " << response << "\n";
-
-            // Parse the response
-            parsed_response = parseQueryResponse(response);
-
-            // Check if parse is empty to prevent segmentation faults
-            if (parsed_response.empty()) {
-                // Manually set first sensor id since there no data found within the name-series (ns). New table?
-                if(verbose) std::cerr << "Warning in InfluxDatabase::copyEpitrendToBucket call: "
-                "parsed response is empty due to empty name-series table.\n";
-                valid_sensor_id = 1;
-
-            } else {
-                // Grab all the sensor_id values
-                std::vector<int> sensor_ids;
-                for(std::unordered_map<std::string,std::string>& element : parsed_response) {
-                    try {
-                        sensor_ids.push_back(stoi(element["_value"]));
-                    }
-                    catch (std::exception& e) {
-                        std::cerr << "Error in InfluxDatabase::copyEpitrendToBucket: error parsing sensor_id\n";
-                        throw std::runtime_error("Error in InfluxDatabase::copyEpitrendToBucket: error parsing sensor_id\n");
-                    }
-                    if(verbose) std::cout << "Found existing sensor_id: " << stoi(element["_value"]) << "\n";
-                }
-
-                // Get the next sensor_id
-                valid_sensor_id = *std::max_element(sensor_ids.begin(), sensor_ids.end()) + 1;
-                if(verbose) std::cout << "Next sensor_id available for \"" << name_data_map.first <<"\": " << valid_sensor_id << "\n";
-
-            }
-
-            // Set the ns write query
-            ns_write_struct ns_write =
-            {
-                .machine_name = epitrend_machine_name,
-                .sensor_name = name_data_map.first,
-                .sensor_id = std::to_string(valid_sensor_id)
-            };
-            ns_write.set_write_query();
-            if(verbose) std::cout << "Write query: " << ns_write.write_query << "\n";
-
-            // Write the new sensor_id with the machine and sensor name into ns
-            writeBatchData2({ns_write.write_query}, verbose);
-
-        } else {
-            if(verbose) std::cout << "Entry found for sensor: " << name_data_map.first << "\n";
-
-            // Get the sensor_id
-            valid_sensor_id = stoi(parsed_response[0]["_value"]);
-            if(verbose) std::cout << "Sensor_id: " << valid_sensor_id << "\n";
+            name << "\n";
 
-        }
+        // Get the sensor id associated with the current sensor name
+        const long long valid_sensor_id = resolver.resolve(name, epitrend_machine_name);
+        if(verbose) std::cout << "Sensor_id: " << valid_sensor_id << "\n";
 
         // Prepare ts query write statement
         ts_write_struct ts_write =
@@ -606,10 +547,10 @@ bool InfluxDatabase::copyEpitrendToBucket(EpitrendBinaryData data, bool verbose)
 
         // Loop through all the time-value pairs for the current name
         std::vector<std::string> batch_data;
-        for (const auto& time_value : name_data_map.second) {
+        for (std::size_t i = 0; i < times.size(); ++i) {
             // Prepare the ts write query
-            ts_write.num = std::to_string(time_value.second);
-            ts_write.timestamp = std::to_string(convertDaysFromEpochToPrecisionFromUnix(time_value.first));
+            ts_write.num = std::to_string(values[i]);
+            ts_write.timestamp = std::to_string(convertDaysFromEpochToPrecisionFromUnix(times[i]));
             ts_write.set_write_query();
 
             // Batch the data
@@ -634,168 +575,67 @@ bool InfluxDatabase::copyEpitrendToBucket(EpitrendBinaryData data, bool verbose)
 }
 
 bool InfluxDatabase::copyEpitrendToBucket2(EpitrendBinaryData data, bool verbose){
+    // Resolve the sensor ids with one read of the ns table
+    SensorIdResolver resolver = loadSensorIdResolver(verbose);
+    writeEpitrendData(data, resolver, verbose);
+    return true;
+}
+
+bool InfluxDatabase::copyEpitrendToBucket2(EpitrendBinaryData data, SeriesFingerprint& fingerprint, bool verbose) {
+    data.finalize(verbose);
+    EpitrendBinaryData new_data = data.difference(fingerprint, true);
+    if(verbose) std::cout << "Samples not in the fingerprint: " << new_data.getSensorCount() << " sensors\n";
+    if(new_data.is_empty()) {
+        return true;
+    }
+
+    SensorIdResolver resolver = loadSensorIdResolver(verbose);
+    writeEpitrendData(new_data, resolver, verbose);
+    new_data.addToFingerprint(fingerprint);
+    return true;
+}
+
+void InfluxDatabase::writeEpitrendData(EpitrendBinaryData& data, SensorIdResolver& resolver, bool verbose) {
     // Batch size
     const int batchSize = 5000;
 
-    // Number of retry calls
-    const int retryCalls = 5;
-
     const std::string epitrend_machine_name = "GEN200";
 
     // Prepare time-series (ts) query write statement e.g.
     //measurement + ",sensor_id_=1 num=299i 1735728000000";
     struct ts_write_struct {
         std::string sensor_id;
-        std::string num;  // MUST BE A DECIMAL
-        std::string timestamp;
-        std::string write_query;
+        std::string num = "";  // MUST BE A DECIMAL
+        std::string timestamp = "";
+        std::string write_query = "";
         void set_write_query(){write_query ="ts,sensor_id_=" +
             sensor_id + " num=" +
             num + " " + timestamp;
         }
     };
 
-    // Prepare name-series (ns) query write statement e.g.
-    //measurement + ",machine_=\"machine.name.2\",sensor_=\"sensor.name.2\" sensor_id=\"4\" " + std::to_string(default_ns_timestamp);
-    struct ns_write_struct {
-        std::string machine_name;
-        std::string sensor_name;
-        std::string sensor_id;
-        std::string default_timestamp = "2000000000000";
-        std::string write_query;
-        void set_write_query(){write_query = "ns,machine_=" + escapeSpecialChars(machine_name) +
-            ",sensor_=" + escapeSpecialChars(sensor_name) +
-            " sensor_id=\"" + sensor_id +
-            "\" " + default_timestamp;
-        }
-    };
-
-    // Prepare name-series (ns) query read statement
-    //     "from(bucket: \"test-bucket\")"
-    //   "|> range(start: -100y, stop: 50y)"
-    //   "|> filter(fn: (r) => r[\"_measurement\"] == \"ns\")"
-    ;
-    struct ns_read_struct {
-        std::string bucket;
-        std::string machine_name;
-        std::string sensor_name;
-        std::string read_query;
-        void set_read_query(){read_query = "from(bucket: \"" + bucket + "\") "
-            "|> range(start: -50y, stop: 100y)"
-            "|> filter(fn: (r) => r[\"_measurement\"] == \"ns\")"
-            "|> filter(fn: (r) => r[\"sensor_\"] == \"" + sensor_name + "\")"
-            "|> filter(fn: (r) => r[\"machine_\"] == \"" + machine_name + "\")";
-        }
-    };
-
-    // Prepare name-series (ns) query read all data statement
-    struct ns_read_all_struct {
-        std::string bucket;
-        std::string read_query;
-        void set_read_query(){read_query = "from(bucket: \"" + bucket + "\") "
-            "|> range(start: -50y, stop: 100y)"
-            "|> filter(fn: (r) => r[\"_measurement\"] == \"ns\")";
-        }
-    };
-
-    // Set the ns read all data query
-    ns_read_all_struct ns_read_all = {.bucket = bucket_};
-    ns_read_all.set_read_query();
-
-    // Read the ns table for all data
-    std::string response;
-    response = "";
-    queryData2(response, ns_read_all.read_query);
-
-    // Parse the response
-    std::vector<std::unordered_map<std::string,std::string>> parsed_response = parseQueryResponse(response);
-
-    // Cache all the sensor-name and sensor-id pairs that exist in the ns table
-    std::unordered_map<std::string, std::string> sensor_names_to_ids;
-    for(const auto& element : parsed_response) {
-        // Check sensor_ and sensor_id_ keys exist (ns table should contain these keys)
-        if(element.find("sensor_") == element.end() || element.find("_value") == element.end()) {
-            std::cerr << "Error in InfluxDatabase::copyEpitrendToBucket2 call: "
-            "sensor_ or sensor_id key not found in ns table\n";
-            throw std::runtime_error("Error in InfluxDatabase::copyEpitrendToBucket2 call: "
-            "sensor_ or sensor_id key not found in ns table\n");
-        }
-
-        // Cache the sensor-name and sensor-id pairs
-        sensor_names_to_ids[element.at("sensor_")] = element.at("_value");
-        //std::cout << "Cached sensor-name: " << element.at("sensor_") << " with sensor-id: " << element.at("_value") << "\n";
+    // Resolve the sensor ids of all names, then add the new names to the ns table in one batch
+    data.finalize(verbose);
+    for(EpitrendBinaryData::SensorIndex sensor = 0; sensor < data.getSensorCount(); ++sensor) {
+        resolver.resolve(data.getName(sensor), epitrend_machine_name);
     }
+    writeNewSensors(resolver, verbose);
 
     // Loop through all data
-    std::unordered_map<std::string, std::unordered_map<double,double>> raw_data = data.getAllTimeSeriesData();
     std::vector<std::string> batch_data;
 
-    for(const auto& name_data_map : raw_data) {
-        // CHECK IF PART NAME IS IN NS TABLE
-        // IF IT ISN'T
-            // ADD ENTRY OF MACHINE NAME AND PART NAME INTO TABLE
-            // GET NEW SENSOR_ID FOR NAME AND ALSO INTO TABLE
-        // IF IT IS
-            // GET THE SENSOR_ID
-        // ENTER ALL ASSOCIATED DATA INTO TS TABLE WITH ASSOCIATE SENSOR ID
+    for(EpitrendBinaryData::SensorIndex sensor = 0; sensor < data.getSensorCount(); ++sensor) {
+        const std::string& name = data.getName(sensor);
+        const std::span<const double> times = data.getTimes(sensor);
+        const std::span<const double> values = data.getValues(sensor);
 
         if(verbose)
             std::cout << "--------------------\n Current name: " <<
-            name_data_map.first << "\n";
-
-        // Prepare the sensor id associated with the current sensor name
-        int valid_sensor_id = -1;
-
-        // Check if sensor_ name exists in the ns table
-        int found_sensor_name_in_ns =
-            !(sensor_names_to_ids.find(escapeSpecialChars(name_data_map.first)) == sensor_names_to_ids.end());
-
-        // Check if data is found
-        if(!found_sensor_name_in_ns) {
-            if(verbose) std::cout << "No entry found for sensor: " << name_data_map.first << "\n";
-
-            // Check if cache is empty to prevent segmentation faults
-            if (sensor_names_to_ids.empty()) {
-                // Manually set first sensor id since there no data found within the name-series (ns). New table?
-                if(verbose) std::cerr << "Warning in InfluxDatabase::copyEpitrendToBucket call: "
-                "no data found in ns table.\n";
-                valid_sensor_id = 1;
-
-            } else {
-                // Get the next sensor_id
-                valid_sensor_id = std::stoi(std::max_element(sensor_names_to_ids.begin(), sensor_names_to_ids.end(),
-                    [](const auto& a, const auto& b) {
-                        return std::stoi(a.second) < std::stoi(b.second);
-                    })->second) + 1;
-
-                if(verbose) std::cout << "Next sensor_id available for \"" << name_data_map.first <<"\": " << valid_sensor_id << "\n";
-
-            }
-
-            // Set the ns write query
-            ns_write_struct ns_write =
-            {
-                .machine_name = epitrend_machine_name,
-                .sensor_name = name_data_map.first,
-                .sensor_id = std::to_string(valid_sensor_id)
-            };
-            ns_write.set_write_query();
-            if(verbose) std::cout << "Write query: " << ns_write.write_query << "\n";
-
-            // Write the new sensor_id with the machine and sensor name into ns
-            writeBatchData2({ns_write.write_query}, verbose);
-
-            // Update the cache
-            sensor_names_to_ids[name_data_map.first] = std::to_string(valid_sensor_id);
-
-        } else {
-            if(verbose) std::cout << "Entry found for sensor: " << name_data_map.first << "\n";
-
-            // Get the sensor_id
-            valid_sensor_id = std::stoi(sensor_names_to_ids.at(name_data_map.first));
-            if(verbose) std::cout << "Sensor_id: " << valid_sensor_id << "\n";
+            name << "\n";
 
-        }
+        // Get the sensor id associated with the current sensor name
+        const long long valid_sensor_id = resolver.resolve(name, epitrend_machine_name);
+        if(verbose) std::cout << "Sensor_id: " << valid_sensor_id << "\n";
 
         // Prepare ts query write statement
         ts_write_struct ts_write =
@@ -804,14 +644,14 @@ bool InfluxDatabase::copyEpitrendToBucket2(EpitrendBinaryData data, bool verbose
         };
 
         // Loop through all the time-value pairs for the current name
-        for (const auto& time_value : name_data_map.second) {
+        for (std::size_t i = 0; i < times.size(); ++i) {
             // Prepare the ts write query
             std::ostringstream num_stream;
-            num_stream << std::setprecision(15) << time_value.second;
+            num_stream << std::setprecision(15) << values[i];
             ts_write.num = num_stream.str();
 
             std::ostringstream timestamp_stream;
-            timestamp_stream << std::setprecision(15) << convertDaysFromEpochToPrecisionFromUnix(time_value.first);
+            timestamp_stream << std::setprecision(15) << convertDaysFromEpochToPrecisionFromUnix(times[i]);
             ts_write.timestamp = timestamp_stream.str();
 
             ts_write.set_write_query();
@@ -823,23 +663,7 @@ bool InfluxDatabase::copyEpitrendToBucket2(EpitrendBinaryData data, bool verbose
                 // Write the time-value pair to the ts table
                 if(verbose) std::cout << "Writing batch data...\n";
 
-                for(int i = 0; i < retryCalls; i++){
-                    try {
-                        writeBatchData2(batch_data, false);
-                        break;
-                    } catch (std::exception& e) {
-                        if(verbose) std::cerr << "Error in InfluxDatabase::copyEpitrendToBucket2 call: error writing to ts table\n";
-                        if(verbose) std::cerr << "Error message: " << e.what() << "\n";
-                        if(verbose) std::cerr << "Retrying...\n";
-                        if (i == 9) {
-                            if(verbose) std::cerr << "Error in InfluxDatabase::copyEpitrendToBucket2 call: failed to write to ts table after " << retryCalls << " attempts\n";
-                            throw std::runtime_error("Error in InfluxDatabase::copyEpitrendToBucket2 call: failed to write to ts table\n");
-                        }
-                        std::this_thread::sleep_for(std::chrono::seconds(1));
-
-                    }
-                }
-                // writeBatchData2(batch_data, false);
+                writeTsBatch(batch_data, "writeEpitrendData", verbose);
                 batch_data.clear();
             }
         }
@@ -850,36 +674,34 @@ bool InfluxDatabase::copyEpitrendToBucket2(EpitrendBinaryData data, bool verbose
     if(batch_data.size() > 0) {
         if(verbose) std::cout << "Writing batch data...\n";
 
-        for(int i = 0; i < retryCalls; i++){
-            try {
-                writeBatchData2(batch_data, false);
-                break;
-            } catch (std::exception& e) {
-                if(verbose) std::cerr << "Error in InfluxDatabase::copyEpitrendToBucket2 call: error writing remaining data to ts table\n";
-                if(verbose) std::cerr << "Error message: " << e.what() << "\n";
-                if(verbose) std::cerr << "Batch size is: " << batch_data.size() << "\n";
-                if(verbose) std::cerr << "Retrying...\n";
-                if (i == 9) {
-                    if(verbose) std::cerr << "Error in InfluxDatabase::copyEpitrendToBucket2 call: failed to write to ts table after " << retryCalls << " attempts\n";
-                    throw std::runtime_error("Error in InfluxDatabase::copyEpitrendToBucket2 call: failed to write to ts table\n");
-                }
-                std::this_thread::sleep_for(std::chrono::seconds(1));
+        writeTsBatch(batch_data, "writeEpitrendData", verbose);
+    }
+}
 
-            }
-        }
-        // writeBatchData2(batch_data, verbose);
+bool InfluxDatabase::copyRGADataToBucket(RGAData data, bool verbose) {
+    // Resolve the sensor ids with one read of the ns table
+    SensorIdResolver resolver = loadSensorIdResolver(verbose);
+    writeRGAData(data, resolver, verbose);
+    return true;
+}
+
+bool InfluxDatabase::copyRGADataToBucket(RGAData data, SeriesFingerprint& fingerprint, bool verbose) {
+    RGAData new_data = data.difference(fingerprint, true);
+    if(verbose) std::cout << "Samples not in the fingerprint: " << new_data.getScanTimes().size() << " scans\n";
+    if(new_data.is_empty()) {
+        return true;
     }
 
+    SensorIdResolver resolver = loadSensorIdResolver(verbose);
+    writeRGAData(new_data, resolver, verbose);
+    new_data.addToFingerprint(fingerprint);
     return true;
 }
 
-bool InfluxDatabase::copyRGADataToBucket(RGAData data, bool verbose) {
+void InfluxDatabase::writeRGAData(RGAData& data, SensorIdResolver& resolver, bool verbose) {
     // Batch size
     const int batchSize = 5000;
 
-    // Number of retry calls
-    const int retryCalls = 5;
-
     const std::string epitrend_machine_name = "GEN200_RGA";
 
 
@@ -887,158 +709,39 @@ bool InfluxDatabase::copyRGADataToBucket(RGAData data, bool verbose) {
     //measurement + ",sensor_id_=1 num=299i 1735728000000";
     struct ts_write_struct {
         std::string sensor_id;
-        std::string num;  // MUST BE A DECIMAL
-        std::string timestamp;
-        std::string write_query;
+        std::string num = "";  // MUST BE A DECIMAL
+        std::string timestamp = "";
+        std::string write_query = "";
         void set_write_query(){write_query ="ts,sensor_id_=" +
             sensor_id + " num=" +
             num + " " + timestamp;
         }
     };
 
-    // Prepare name-series (ns) query write statement e.g.
-    //measurement + ",machine_=\"machine.name.2\",sensor_=\"sensor.name.2\" sensor_id=\"4\" " + std::to_string(default_ns_timestamp);
-    struct ns_write_struct {
-        std::string machine_name;
-        std::string sensor_name;
-        std::string sensor_id;
-        std::string default_timestamp = "2000000000000";
-        std::string write_query;
-        void set_write_query(){write_query = "ns,machine_=" + escapeSpecialChars(machine_name) +
-            ",sensor_=" + escapeSpecialChars(sensor_name) +
-            " sensor_id=\"" + sensor_id +
-            "\" " + default_timestamp;
-        }
-    };
-
-    // Prepare name-series (ns) query read statement
-    //     "from(bucket: \"test-bucket\")"
-    //   "|> range(start: -100y, stop: 50y)"
-    //   "|> filter(fn: (r) => r[\"_measurement\"] == \"ns\")"
-    ;
-    struct ns_read_struct {
-        std::string bucket;
-        std::string machine_name;
-        std::string sensor_name;
-        std::string read_query;
-        void set_read_query(){read_query = "from(bucket: \"" + bucket + "\") "
-            "|> range(start: -50y, stop: 100y)"
-            "|> filter(fn: (r) => r[\"_measurement\"] == \"ns\")"
-            "|> filter(fn: (r) => r[\"sensor_\"] == \"" + sensor_name + "\")"
-            "|> filter(fn: (r) => r[\"machine_\"] == \"" + machine_name + "\")";
-        }
-    };
-
-    // Prepare name-series (ns) query read all data statement
-    struct ns_read_all_struct {
-        std::string bucket;
-        std::string read_query;
-        void set_read_query(){read_query = "from(bucket: \"" + bucket + "\") "
-            "|> range(start: -50y, stop: 100y)"
-            "|> filter(fn: (r) => r[\"_measurement\"] == \"ns\")";
-        }
-    };
-
-    // Set the ns read all data query
-    ns_read_all_struct ns_read_all = {.bucket = bucket_};
-    ns_read_all.set_read_query();
-
-    // Read the ns table for all data
-    std::string response;
-    response = "";
-    queryData2(response, ns_read_all.read_query);
-
-    // Parse the response
-    std::vector<std::unordered_map<std::string,std::string>> parsed_response = parseQueryResponse(response);
-
-    // Cache all the sensor-name and sensor-id pairs that exist in the ns table
-    std::unordered_map<std::string, std::string> sensor_names_to_ids;
-    for(const auto& element : parsed_response) {
-        // Check sensor_ and sensor_id_ keys exist (ns table should contain these keys)
-        if(element.find("sensor_") == element.end() || element.find("_value") == element.end()) {
-            std::cerr << "Error in InfluxDatabase::copyEpitrendToBucket2 call: "
-            "sensor_ or sensor_id key not found as an entry into ns table\n";
-            throw std::runtime_error("Error in InfluxDatabase::copyEpitrendToBucket2 call: "
-            "sensor_ or sensor_id key not found as an entry into ns table\n");
+    // Resolve the sensor ids of all bins with samples, then add the new names to the ns table in one batch
+    std::vector<RGAData::BinIndex> bins_with_samples;
+    for (RGAData::BinIndex bin = 0; bin < data.getBinCount(); ++bin) {
+        if (data.getSampleCount(bin) > 0) {
+            bins_with_samples.push_back(bin);
+            resolver.resolve("RGA." + data.getBins(bin).binsString(), epitrend_machine_name);
         }
-
-        // Cache the sensor-name and sensor-id pairs
-        sensor_names_to_ids[element.at("sensor_")] = element.at("_value");
-        //std::cout << "Cached sensor-name: " << element.at("sensor_") << " with sensor-id: " << element.at("_value") << "\n";
     }
+    writeNewSensors(resolver, verbose);
 
     // Loop through all data
-    const auto& raw_data = data.getAllTimeSeriesData();
     std::vector<std::string> batch_data;
+    const std::span<const double> scan_times = data.getScanTimes();
 
-    for(const auto& name_data_map : raw_data) {
-        // CHECK IF PART NAME IS IN NS TABLE
-        // IF IT ISN'T
-            // ADD ENTRY OF MACHINE NAME AND PART NAME INTO TABLE
-            // GET NEW SENSOR_ID FOR NAME AND ALSO INTO TABLE
-        // IF IT IS
-            // GET THE SENSOR_ID
-        // ENTER ALL ASSOCIATED DATA INTO TS TABLE WITH ASSOCIATE SENSOR ID
-
-        std::string name = "RGA." + name_data_map.first.binsString();
+    for (const RGAData::BinIndex bin : bins_with_samples) {
+        std::string name = "RGA." + data.getBins(bin).binsString();
 
         if(verbose)
             std::cout << "--------------------\n Current name: " <<
             name << "\n";
 
-        // Prepare the sensor id associated with the current sensor name
-        int valid_sensor_id = -1;
-
-        // Check if sensor_ name exists in the ns table
-        int found_sensor_name_in_ns =
-            !(sensor_names_to_ids.find(escapeSpecialChars(name)) == sensor_names_to_ids.end());
-
-        // Check if data is found
-        if(!found_sensor_name_in_ns) {
-            if(verbose) std::cout << "No entry found for sensor: " << name << "\n";
-
-            // Check if cache is empty to prevent segmentation faults
-            if (sensor_names_to_ids.empty()) {
-                // Manually set first sensor id since there no data found within the name-series (ns). New table?
-                if(verbose) std::cerr << "Warning in InfluxDatabase::copyEpitrendToBucket call: "
-                "no data found in ns table.\n";
-                valid_sensor_id = 1;
-
-            } else {
-                // Get the next sensor_id
-                valid_sensor_id = std::stoi(std::max_element(sensor_names_to_ids.begin(), sensor_names_to_ids.end(),
-                    [](const auto& a, const auto& b) {
-                        return std::stoi(a.second) < std::stoi(b.second);
-                    })->second) + 1;
-
-                if(verbose) std::cout << "Next sensor_id available for \"" << name <<"\": " << valid_sensor_id << "\n";
-
-            }
-
-            // Set the ns write query
-            ns_write_struct ns_write =
-            {
-                .machine_name = epitrend_machine_name,
-                .sensor_name = name,
-                .sensor_id = std::to_string(valid_sensor_id)
-            };
-            ns_write.set_write_query();
-            if(verbose) std::cout << "Write query: " << ns_write.write_query << "\n";
-
-            // Write the new sensor_id with the machine and sensor name into ns
-            writeBatchData2({ns_write.write_query}, verbose);
-
-            // Update the cache
-            sensor_names_to_ids[escapeSpecialChars(name)] = std::to_string(valid_sensor_id);
-
-        } else {
-            if(verbose) std::cout << "Entry found for sensor: " << name << "\n";
-
-            // Get the sensor_id
-            valid_sensor_id = std::stoi(sensor_names_to_ids.at(name));
-            if(verbose) std::cout << "Sensor_id: " << valid_sensor_id << "\n";
-
-        }
+        // Get the sensor id associated with the current sensor name
+        const long long valid_sensor_id = resolver.resolve(name, epitrend_machine_name);
+        if(verbose) std::cout << "Sensor_id: " << valid_sensor_id << "\n";
 
         // Prepare ts query write statement
         ts_write_struct ts_write =
@@ -1054,15 +757,20 @@ bool InfluxDatabase::copyRGADataToBucket(RGAData data, bool verbose) {
         num_stream.precision(15);
         num_stream << std::fixed;
 
-        // Loop through all the time-value pairs for the current name
-        for (const auto& time_value : name_data_map.second) {
+        // Loop through all the scans with a sample of the current bins
+        for (std::size_t scan = 0; scan < scan_times.size(); ++scan) {
+            const double value = data.getScan(scan)[bin];
+            if (std::isnan(value)) {
+                continue;
+            }
+
             // Prepare the ts write query
             num_stream.str("");
-            num_stream << time_value.second;
+            num_stream << value;
             ts_write.num = num_stream.str();
 
             timestamp_stream.str("");
-            timestamp_stream << convertSecondsFromUnixToPrecisionFromUnix(time_value.first);
+            timestamp_stream << convertSecondsFromUnixToPrecisionFromUnix(scan_times[scan]);
             ts_write.timestamp = timestamp_stream.str();
 
             ts_write.set_write_query();
@@ -1077,23 +785,7 @@ bool InfluxDatabase::copyRGADataToBucket(RGAData data, bool verbose) {
                 // Write the time-value pair to the ts table
                 if(verbose) std::cout << "Writing batch data...\n";
 
-                for(int i = 0; i < retryCalls; i++){
-                    try {
-                        writeBatchData2(batch_data, false);
-                        break;
-                    } catch (std::exception& e) {
-                        if(verbose) std::cerr << "Error in InfluxDatabase::copyEpitrendToBucket2 call: error writing to ts table\n";
-                        if(verbose) std::cerr << "Error message: " << e.what() << "\n";
-                        if(verbose) std::cerr << "Retrying...\n";
-                        if (i == 9) {
-                            if(verbose) std::cerr << "Error in InfluxDatabase::copyEpitrendToBucket2 call: failed to write to ts table after " << retryCalls << " attempts\n";
-                            throw std::runtime_error("Error in InfluxDatabase::copyEpitrendToBucket2 call: failed to write to ts table\n");
-                        }
-                        std::this_thread::sleep_for(std::chrono::seconds(1));
-
-                    }
-                }
-                // writeBatchData2(batch_data, false);
+                writeTsBatch(batch_data, "writeRGAData", verbose);
                 batch_data.clear();
             }
         }
@@ -1104,25 +796,118 @@ bool InfluxDatabase::copyRGADataToBucket(RGAData data, bool verbose) {
     if(batch_data.size() > 0) {
         if(verbose) std::cout << "Writing batch data...\n";
 
-        for(int i = 0; i < retryCalls; i++){
-            try {
-                writeBatchData2(batch_data, false);
-                break;
-            } catch (std::exception& e) {
-                if(verbose) std::cerr << "Error in InfluxDatabase::copyEpitrendToBucket2 call: error writing remaining data to ts table\n";
-                if(verbose) std::cerr << "Error message: " << e.what() << "\n";
-                if(verbose) std::cerr << "Batch size is: " << batch_data.size() << "\n";
-                if(verbose) std::cerr << "Retrying...\n";
-                if (i == 9) {
-                    if(verbose) std::cerr << "Error in InfluxDatabase::copyEpitrendToBucket2 call: failed to write to ts table after " << retryCalls << " attempts\n";
-                    throw std::runtime_error("Error in InfluxDatabase::copyEpitrendToBucket2 call: failed to write to ts table\n");
-                }
-                std::this_thread::sleep_for(std::chrono::seconds(1));
+        writeTsBatch(batch_data, "writeRGAData", verbose);
+    }
+}
+
+// Read the whole ns table into a resolver. Throws std::runtime_error if a row has no sensor name or id
+SensorIdResolver InfluxDatabase::loadSensorIdResolver(bool verbose) {
+    // Prepare name-series (ns) query read all data statement
+    struct ns_read_all_struct {
+        std::string bucket;
+        std::string read_query = "";
+        void set_read_query(){read_query = "from(bucket: \"" + bucket + "\") "
+            "|> range(start: -50y, stop: 100y)"
+            "|> filter(fn: (r) => r[\"_measurement\"] == \"ns\")";
+        }
+    };
+
+    // Set the ns read all data query
+    ns_read_all_struct ns_read_all = {.bucket = bucket_};
+    ns_read_all.set_read_query();
+
+    // Read the ns table for all data
+    std::string response;
+    queryData2(response, ns_read_all.read_query);
+    if(verbose) std::cout << "Query: " << ns_read_all.read_query << "\n";
+
+    // Parse the response into an arena that is released in one shot at the end of this function
+    std::pmr::monotonic_buffer_resource arena(response.size() * 2, getQueryMemoryResource());
+    std::pmr::vector<QueryRow> parsed_response = parseQueryResponseInto(response, &arena);
 
+    SensorIdResolver resolver;
+    for(const auto& element : parsed_response) {
+        // Check machine_, sensor_ and sensor_id_ keys exist (ns table should contain these keys)
+        if(element.find("machine_") == element.end() || element.find("sensor_") == element.end() ||
+           element.find("_value") == element.end()) {
+            std::cerr << "Error in InfluxDatabase::loadSensorIdResolver call: "
+            "machine_, sensor_ or sensor_id key not found in ns table\n";
+            throw std::runtime_error("Error in InfluxDatabase::loadSensorIdResolver call: "
+            "machine_, sensor_ or sensor_id key not found in ns table\n");
+        }
+        resolver.addExisting(std::string(element.at("sensor_")), std::string(element.at("machine_")),
+            std::string(element.at("_value")));
+    }
+    if(verbose) std::cout << "Loaded " << resolver.size() << " sensors from the ns table\n";
+    return resolver;
+}
+
+// Write a batch of ts rows, retrying a failed write a few times before throwing
+void InfluxDatabase::writeTsBatch(const std::vector<std::string>& batch_data, const std::string& caller, bool verbose) {
+    // Number of retry calls
+    const int retryCalls = 5;
+
+    for(int attempt = 0; attempt < retryCalls; attempt++){
+        try {
+            writeBatchData2(batch_data, false);
+            return;
+        } catch (std::exception& e) {
+            if(verbose) std::cerr << "Error in InfluxDatabase::" << caller << " call: error writing to ts table\n";
+            if(verbose) std::cerr << "Error message: " << e.what() << "\n";
+            if(verbose) std::cerr << "Batch size is: " << batch_data.size() << "\n";
+            if (attempt == retryCalls - 1) {
+                if(verbose) std::cerr << "Error in InfluxDatabase::" << caller << " call: failed to write to ts table after " << retryCalls << " attempts\n";
+                throw std::runtime_error("Error in InfluxDatabase::" + caller + " call: failed to write to ts table\n");
             }
+            if(verbose) std::cerr << "Retrying...\n";
+            std::this_thread::sleep_for(std::chrono::seconds(1));
         }
-        // writeBatchData2(batch_data, verbose);
     }
+}
 
-    return true;
+// Write the sensors the resolver assigned new ids to into the ns table, in one batch
+void InfluxDatabase::writeNewSensors(SensorIdResolver& resolver, bool verbose) {
+    // Prepare name-series (ns) query write statement e.g.
+    //measurement + ",machine_=\"machine.name.2\",sensor_=\"sensor.name.2\" sensor_id=\"4\" " + std::to_string(default_ns_timestamp);
+    struct ns_write_struct {
+        std::string machine_name;
+        std::string sensor_name;
+        std::string sensor_id;
+        std::string default_timestamp = "2000000000000";
+        std::string write_query = "";
+        void set_write_query(){write_query = "ns,machine_=" + escapeSpecialChars(machine_name) +
+            ",sensor_=" + escapeSpecialChars(sensor_name) +
+            " sensor_id=\"" + sensor_id +
+            "\" " + default_timestamp;
+        }
+    };
+
+    std::vector<SensorIdResolver::NewSensor> new_sensors = resolver.takeNewSensors();
+    if (new_sensors.empty()) {
+        return;
+    }
+
+    std::vector<std::string> batch_data;
+    batch_data.reserve(new_sensors.size());
+    for (const auto& sensor : new_sensors) {
+        ns_write_struct ns_write =
+        {
+            .machine_name = sensor.machine,
+            .sensor_name = sensor.name,
+            .sensor_id = std::to_string(sensor.id)
+        };
+        ns_write.set_write_query();
+        if(verbose) std::cout << "Write query: " << ns_write.write_query << "\n";
+        batch_data.push_back(std::move(ns_write.write_query));
+    }
+
+    // Write the new sensor_ids with the machine and sensor names into ns. On failure they are queued
+    // again, so the next write retries them
+    if(verbose) std::cout << "Writing " << batch_data.size() << " new sensors to the ns table...\n";
+    try {
+        writeBatchData2(batch_data, verbose);
+    } catch (...) {
+        resolver.requeueNewSensors(std::move(new_sensors));
+        throw;
+    }
 }
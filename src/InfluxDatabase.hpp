@@ -5,6 +5,8 @@
 #include "influxdb.hpp"
 #include "EpitrendBinaryData.hpp"
 #include "RGAData.hpp"
+#include "SensorIdResolver.hpp"
+#include "MemoryResources.hpp"
 
 #include <curl/curl.h>
 
@@ -58,11 +60,24 @@ public:
     std::vector<std::unordered_map<std::string, std::string>> parseQueryResult(const std::string& response);
     std::vector<std::unordered_map<std::string,std::string>> parseQueryResponse(std::string& response, bool verbose = false);
 
+    // Parsing query into a caller-owned arena (e.g. a std::pmr::monotonic_buffer_resource): the rows and all
+    // their strings are released in one shot with the arena instead of one by one on the global heap
+    using QueryRow = std::pmr::unordered_map<std::pmr::string, std::pmr::string>;
+    std::pmr::vector<QueryRow> parseQueryResponseInto(const std::string& response, std::pmr::memory_resource* arena, bool verbose = false);
+
     // Copying to bucket
     bool copyEpitrendToBucket(EpitrendBinaryData data, bool verbose = false);
     bool copyEpitrendToBucket2(EpitrendBinaryData data, bool verbose = false);
     bool copyRGADataToBucket(RGAData data, bool verbose = false);
 
+    // Incremental copies: write only the samples the fingerprint does not record as uploaded, then record
+    // them. The fingerprint is left unchanged if a write fails. Loading and saving it is up to the caller
+    bool copyEpitrendToBucket2(EpitrendBinaryData data, SeriesFingerprint& fingerprint, bool verbose = false);
+    bool copyRGADataToBucket(RGAData data, SeriesFingerprint& fingerprint, bool verbose = false);
+
+    // Sensor ids of the ns table, with one read of the whole table
+    SensorIdResolver loadSensorIdResolver(bool verbose = false);
+
 
 private:
     influxdb_cpp::server_info serverInfo;
@@ -80,6 +95,16 @@ private:
 
     // Internal using of splitting by delimiter
     static std::vector<std::string> split(std::string s, const std::string& delimiter);
+    static void split(std::string_view s, char delimiter, std::pmr::vector<std::string_view>& tokens);
+
+    // Add the sensors the resolver assigned new ids to to the ns table, in one batched write
+    void writeNewSensors(SensorIdResolver& resolver, bool verbose = false);
+
+    // Write samples to the ts table, adding their new sensors to the ns table first
+    void writeEpitrendData(EpitrendBinaryData& data, SensorIdResolver& resolver, bool verbose = false);
+    void writeRGAData(RGAData& data, SensorIdResolver& resolver, bool verbose = false);
+    // Write a batch of ts rows, retrying before it throws std::runtime_error naming the caller
+    void writeTsBatch(const std::vector<std::string>& batch_data, const std::string& caller, bool verbose = false);
 
     // Internal trim function
     static std::string trimInternal(const std::string& str);
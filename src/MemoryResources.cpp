@@ -0,0 +1,85 @@
+#include "MemoryResources.hpp"
+
+CountingMemoryResource::CountingMemoryResource(std::pmr::memory_resource* upstream)
+    : upstream_(upstream) {}
+
+AllocationStats CountingMemoryResource::getStats() const {
+    return {
+        .bytes_in_use = bytes_in_use_.load(),
+        .peak_bytes_in_use = peak_bytes_in_use_.load(),
+        .allocations = allocations_.load(),
+        .deallocations = deallocations_.load()
+    };
+}
+
+void* CountingMemoryResource::do_allocate(std::size_t bytes, std::size_t alignment) {
+    void* p = upstream_->allocate(bytes, alignment);
+    const std::size_t in_use = bytes_in_use_.fetch_add(bytes) + bytes;
+    ++allocations_;
+
+    // Raise the peak if this allocation exceeded it
+    std::size_t peak = peak_bytes_in_use_.load();
+    while (in_use > peak && !peak_bytes_in_use_.compare_exchange_weak(peak, in_use)) {
+    }
+    return p;
+}
+
+void CountingMemoryResource::do_deallocate(void* p, std::size_t bytes, std::size_t alignment) {
+    upstream_->deallocate(p, bytes, alignment);
+    bytes_in_use_ -= bytes;
+    ++deallocations_;
+}
+
+bool CountingMemoryResource::do_is_equal(const std::pmr::memory_resource& other) const noexcept {
+    return this == &other;
+}
+
+
+
+
+// ==================================================
+// Shared memory resources
+// ==================================================
+// Function-local statics so they are constructed before first use and outlive every buffer
+struct TimeSeriesMemory {
+    CountingMemoryResource system; // What the pool takes from the heap
+    std::pmr::synchronized_pool_resource pool;
+    CountingMemoryResource chunks; // What the chunks take from the pool
+
+    TimeSeriesMemory()
+        : pool(std::pmr::pool_options{
+              .max_blocks_per_chunk = 64,
+              .largest_required_pool_block = 64 * 1024 // Covers full chunks of 4096 8-byte samples
+          }, &system),
+          chunks(&pool) {}
+};
+
+static TimeSeriesMemory& timeSeriesMemory() {
+    static TimeSeriesMemory memory;
+    return memory;
+}
+
+static CountingMemoryResource& queryMemory() {
+    static CountingMemoryResource memory;
+    return memory;
+}
+
+std::pmr::memory_resource* getTimeSeriesMemoryResource() {
+    return &timeSeriesMemory().chunks;
+}
+
+std::pmr::memory_resource* getQueryMemoryResource() {
+    return &queryMemory();
+}
+
+AllocationStats getTimeSeriesAllocationStats() {
+    return timeSeriesMemory().chunks.getStats();
+}
+
+AllocationStats getTimeSeriesPoolStats() {
+    return timeSeriesMemory().system.getStats();
+}
+
+AllocationStats getQueryAllocationStats() {
+    return queryMemory().getStats();
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <memory_resource>
+
+// Allocation counters of a CountingMemoryResource
+struct AllocationStats {
+    std::size_t bytes_in_use = 0;
+    std::size_t peak_bytes_in_use = 0;
+    std::size_t allocations = 0; // Total since start
+    std::size_t deallocations = 0; // Total since start
+};
+
+// Memory resource that forwards to an upstream resource and counts what goes through it. Thread safe
+class CountingMemoryResource : public std::pmr::memory_resource {
+public:
+    explicit CountingMemoryResource(std::pmr::memory_resource* upstream = std::pmr::new_delete_resource());
+
+    AllocationStats getStats() const;
+
+private:
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+    void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) override;
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+
+    std::pmr::memory_resource* upstream_;
+    std::atomic<std::size_t> bytes_in_use_{0};
+    std::atomic<std::size_t> peak_bytes_in_use_{0};
+    std::atomic<std::size_t> allocations_{0};
+    std::atomic<std::size_t> deallocations_{0};
+};
+
+
+
+
+// ==================================================
+// Shared memory resources
+// ==================================================
+// Time-series chunk storage: a size-class pool shared by all buffers. Freed chunks go back to the pool and
+// are reused by the next chunks of any sensor, so the heap does not fragment over long sessions
+std::pmr::memory_resource* getTimeSeriesMemoryResource();
+
+// Upstream for per-query arenas (std::pmr::monotonic_buffer_resource), which are released in one shot
+std::pmr::memory_resource* getQueryMemoryResource();
+
+// Diagnostics
+AllocationStats getTimeSeriesAllocationStats(); // Bytes handed out to chunks
+AllocationStats getTimeSeriesPoolStats(); // Bytes the chunk pool holds from the system
+AllocationStats getQueryAllocationStats(); // Bytes held by query arenas
@@ -1,107 +1,359 @@
 #include "RGAData.hpp"
+#include "series_difference.hpp"
 
 // Constructor with bins per unit
 RGAData::RGAData(const int& bins_per_unit) {
     // Force that bins_per_unit must be less than 5
-    if (bins_per_unit > 9) {
+    if (bins_per_unit > MAX_BINS_PER_UNIT) {
         throw std::runtime_error("Error in RGAData constructor: bins per unit must be less than 10");
     }
 
     // Initialize bins around integers 1 to 99
-    for (int i = 1; i <= 99; ++i) {
+    for (int i = MIN_UNIT; i <= MAX_UNIT; ++i) {
+        getUnitBins(i, bins_per_unit);
+    }
+}
+
+bool RGAData::parseSensorName(std::string_view name, double& center) {
+    // SENSOR_PREFIX, GM, '.', then the bins with two decimals joined by '_'
+    const std::string_view prefix = SENSOR_PREFIX;
+    if (name.substr(0, prefix.size()) != prefix) {
+        return false;
+    }
+    name.remove_prefix(prefix.size());
+    const std::size_t gm_end = name.find('.');
+    if (gm_end == std::string_view::npos) {
+        return false;
+    }
+    const std::string bins(name.substr(gm_end + 1));
+    const std::size_t last_separator = bins.rfind('_');
+
+    char* end;
+    const double first = std::strtod(bins.c_str(), &end);
+    if (end == bins.c_str()) {
+        return false;
+    }
+    const char* last_begin = last_separator == std::string::npos ? bins.c_str() : bins.c_str() + last_separator + 1;
+    const double last = std::strtod(last_begin, &end);
+    if (end == last_begin || *end != '\0') {
+        return false;
+    }
+    center = (first + last) / 2;
+    return true;
+}
+
+RGAData::BinIndex RGAData::addBins(const AMUBins& bins) {
+    int unit, bins_per_unit;
+    if (matchUnitBins(bins.bins.begin(), bins.bins.end(), bins.bins.size(), unit, bins_per_unit)) {
+        return getUnitBins(unit, bins_per_unit, bins.GM);
+    }
+
+    auto it = bin_indices_.find(bins);
+    if (it == bin_indices_.end()) {
+        it = bin_indices_.emplace(bins, appendBins(bins)).first;
+    }
+    return it->second;
+}
+
+RGAData::BinIndex RGAData::getUnitBins(int unit, int bins_per_unit, const std::string& GM) {
+    if (unit < MIN_UNIT || unit > MAX_UNIT || bins_per_unit < 0 || bins_per_unit > MAX_BINS_PER_UNIT) {
+        throw std::runtime_error("Error in RGAData::getUnitBins call: unit or bins per unit out of range");
+    }
+
+    auto table = std::find_if(unit_bins_.begin(), unit_bins_.end(),
+        [&GM](const auto& gm_table) { return gm_table.first == GM; });
+    if (table == unit_bins_.end()) {
+        unit_bins_.emplace_back(GM, std::vector<BinIndex>((MAX_BINS_PER_UNIT + 1) * (MAX_UNIT + 1), NO_BIN));
+        table = std::prev(unit_bins_.end());
+    }
+
+    BinIndex& bin = table->second[bins_per_unit * (MAX_UNIT + 1) + unit];
+    if (bin == NO_BIN) {
         std::vector<double> bin_values;
         for (int j = 0; j < 2 * bins_per_unit + 1; ++j) {
-            bin_values.push_back(i - (double) bins_per_unit * 0.1 + (double) j * 0.1);
+            bin_values.push_back(unitBinValue(unit, bins_per_unit, j));
         }
-        AMUBins amubins(bin_values);
-        allTimeSeriesData[amubins] = std::unordered_map<double, double>();
+        AMUBins bins(bin_values);
+        bins.GM = GM;
+        bin = appendBins(bins);
+    }
+    return bin;
+}
+
+RGAData::BinIndex RGAData::getBinIndex(std::span<const double> bin_values, const std::string& GM) {
+    int unit, bins_per_unit;
+    if (matchUnitBins(bin_values.begin(), bin_values.end(), bin_values.size(), unit, bins_per_unit)) {
+        return getUnitBins(unit, bins_per_unit, GM);
     }
+    AMUBins bins(std::vector<double>(bin_values.begin(), bin_values.end()));
+    bins.GM = GM;
+    return addBins(bins);
 }
 
 void RGAData::addData(const RGAData::AMUBins& bins, double time, double value) {
-    allTimeSeriesData[bins][time] = value;
+    addData(addBins(bins), time, value);
+}
+
+void RGAData::addData(BinIndex bin, double time, double value) {
+    if (std::isnan(time) || std::isnan(value)) {
+        throw std::runtime_error("Error in RGAData::addData call: NaN time or value");
+    }
+    setValue(findScan(time), bin, value);
+}
 
-    // Increment byteSize of object
-    byteSize = byteSize + 16 + bins.bins.size() * 8; // 8 bytes * 2 + 8 bytes * number of bins
+void RGAData::reserveScans(std::size_t scans) {
+    scan_times_.reserve(scans);
+    values_.reserve(scans * stride_);
 }
 
 int RGAData::getByteSize() const {
     return byteSize;
 }
 
-const std::unordered_map<RGAData::AMUBins, std::unordered_map<double, double, std::hash<double>, std::equal_to<double>, std::allocator<std::pair<const double, double>>>, RGAData::AMUBinsHash, std::equal_to<RGAData::AMUBins>, std::allocator<std::pair<const RGAData::AMUBins, std::unordered_map<double, double, std::hash<double>, std::equal_to<double>, std::allocator<std::pair<const double, double>>>>>>& RGAData::getAllTimeSeriesData() const {
-    return allTimeSeriesData;
+std::size_t RGAData::getBinCount() const { return bins_.size(); }
+const RGAData::AMUBins& RGAData::getBins(BinIndex bin) const { return bins_[bin]; }
+const std::vector<RGAData::AMUBins>& RGAData::getBins() const { return bins_; }
+std::size_t RGAData::getScanCount() const { return scan_times_.size(); }
+std::span<const double> RGAData::getScanTimes() const { return scan_times_; }
+
+std::span<const double> RGAData::getScan(std::size_t scan) const {
+    return std::span<const double>(values_.data() + scan * stride_, bins_.size());
 }
 
-const std::vector<RGAData::AMUBins> RGAData::getBins() {
-    std::vector<RGAData::AMUBins> bins;
-    for(auto element : allTimeSeriesData){
-        bins.push_back(element.first);
+std::size_t RGAData::getSampleCount(BinIndex bin) const {
+    std::size_t count = 0;
+    for (std::size_t scan = 0; scan < scan_times_.size(); ++scan) {
+        count += !std::isnan(values_[scan * stride_ + bin]);
     }
-    return bins;
+    return count;
 }
 
 void RGAData::clearData() {
-    // Clear all the map within each AMUBins
-    for(auto element : allTimeSeriesData){
-        element.second.clear();
-    }
-    
+    // The bin table and the allocations are kept for the next scans
+    scan_times_.clear();
+    values_.clear();
+    last_scan_ = 0;
+
     // Reset byteSize
     byteSize = 0;
 }
 
 void RGAData::printAllTimeSeriesData(){
-    for(auto element : allTimeSeriesData){
+    for (BinIndex bin = 0; bin < bins_.size(); ++bin) {
         std::string bin_str = "";
-        for(auto bin : element.first.bins){
-            bin_str += std::to_string(bin) + ",";
+        for(auto bin_value : bins_[bin].bins){
+            bin_str += std::to_string(bin_value) + ",";
         }
         // Remove the last comma
         if(!bin_str.empty()) bin_str.pop_back();
         std::cout << bin_str << "\n";
-        
-        for(auto inner_element : element.second){
-            std::cout << "  " << inner_element.first << "," << inner_element.second << "\n";
+
+        for (std::size_t scan : scansWithSamples(bin)) {
+            std::cout << "  " << scan_times_[scan] << "," << values_[scan * stride_ + bin] << "\n";
         }
     }
 }
 
 void RGAData::printFileAllTimeSeriesData(const Config& config, const std::string& filename) {
     std::ofstream outFile(config.getOutputDir() + filename);
-    for(auto element : allTimeSeriesData) {
+    for (BinIndex bin = 0; bin < bins_.size(); ++bin) {
         std::string bin_str = "";
-        for(auto bin : element.first.bins){
-            bin_str += std::to_string(bin) + ",";
+        for(auto bin_value : bins_[bin].bins){
+            bin_str += std::to_string(bin_value) + ",";
         }
         // Remove the last comma
         if(!bin_str.empty()) bin_str.pop_back();
         outFile << bin_str << "\n";
-        
-        for(auto inner_element : element.second) {
-            outFile << inner_element.first << "," << inner_element.second << "\n";
+
+        for (std::size_t scan : scansWithSamples(bin)) {
+            outFile << scan_times_[scan] << "," << values_[scan * stride_ + bin] << "\n";
         }
     }
 }
 
-RGAData RGAData::difference(const RGAData& other) const {
-    const auto& other_data = other.getAllTimeSeriesData();
-    RGAData diff_data;
-    for(const auto& element : allTimeSeriesData){
-        AMUBins amubin = element.first;
-        std::unordered_map<double,double> time_series = element.second;
-        for(auto inner_element : time_series){
-            double time = inner_element.first;
-            double value = inner_element.second;
-            if(other_data.find(amubin) == other_data.end() || other_data.at(amubin).find(time) == other_data.at(amubin).end()){
-                diff_data.addData(amubin, time, value); // Pass AMUBins type directly
-            }
+RGAData RGAData::difference(const RGAData& other, bool parallel) const {
+    // Column of every bins in other, or bins_.size() when other does not have them
+    std::vector<std::size_t> other_bins(bins_.size(), other.bins_.size());
+    for (BinIndex bin = 0; bin < bins_.size(); ++bin) {
+        const BinIndex other_bin = other.findBins(bins_[bin]);
+        if (other_bin != NO_BIN) {
+            other_bins[bin] = other_bin;
         }
     }
 
-    return diff_data;
+    // Walk the two sorted scan time vectors in step to pair up the scans of equal time
+    constexpr std::size_t no_scan = std::numeric_limits<std::size_t>::max();
+    std::vector<std::size_t> other_scans(scan_times_.size(), no_scan);
+    std::size_t other_scan = 0;
+    for (std::size_t scan = 0; scan < scan_times_.size(); ++scan) {
+        while (other_scan < other.scan_times_.size() && other.scan_times_[other_scan] < scan_times_[scan]) {
+            ++other_scan;
+        }
+        if (other_scan < other.scan_times_.size() && other.scan_times_[other_scan] == scan_times_[scan]) {
+            other_scans[scan] = other_scan;
+        }
+    }
+
+    // Each scan writes only its own row of the result, so scans can be diffed concurrently
+    const std::size_t bin_count = bins_.size();
+    std::vector<double> result(scan_times_.size() * bin_count, NO_SAMPLE);
+    parallelFor(scan_times_.size(), parallel, [&](std::size_t scan) {
+        const std::span<const double> values = getScan(scan);
+        double* result_row = result.data() + scan * bin_count;
+        if (other_scans[scan] == no_scan) {
+            std::copy(values.begin(), values.end(), result_row);
+            return;
+        }
+
+        const std::span<const double> other_values = other.getScan(other_scans[scan]);
+        for (std::size_t bin = 0; bin < bin_count; ++bin) {
+            if (other_bins[bin] == other.bins_.size() || std::isnan(other_values[other_bins[bin]])) {
+                result_row[bin] = values[bin];
+            }
+        }
+    });
+    return makeDifference(result);
+}
+
+RGAData RGAData::difference(const SeriesFingerprint& fingerprint, bool parallel) const {
+    // Each bins writes only its own column of the result, so bins can be diffed concurrently
+    const std::size_t bin_count = bins_.size();
+    std::vector<double> result(scan_times_.size() * bin_count, NO_SAMPLE);
+    parallelFor(bin_count, parallel, [&](std::size_t bin) {
+        const std::vector<std::size_t> scans = scansWithSamples(static_cast<BinIndex>(bin));
+        fingerprintDifference(scans.begin(), scans.end(), [this](std::size_t scan) { return scan_times_[scan]; },
+            fingerprint, fingerprint.find("RGA." + bins_[bin].binsString()),
+            [&](std::vector<std::size_t>::const_iterator it) {
+                result[*it * bin_count + bin] = values_[*it * stride_ + bin];
+            });
+    });
+    return makeDifference(result);
+}
+
+void RGAData::addToFingerprint(SeriesFingerprint& fingerprint) const {
+    for (BinIndex bin = 0; bin < bins_.size(); ++bin) {
+        const std::vector<std::size_t> scans = scansWithSamples(bin);
+        if (scans.empty()) {
+            continue;
+        }
+        fingerprint.add("RGA." + bins_[bin].binsString(), fingerprintWindows(scans.begin(), scans.end(),
+            [this](std::size_t scan) { return scan_times_[scan]; }, fingerprint));
+    }
 }
 
 bool RGAData::is_empty() const {
-    return allTimeSeriesData.empty();
+    return scan_times_.empty();
+}
+
+template<typename BinIt>
+bool RGAData::matchUnitBins(BinIt first, BinIt last, std::size_t count, int& unit, int& bins_per_unit) {
+    if (count == 0 || count % 2 == 0 || count > 2 * MAX_BINS_PER_UNIT + 1) {
+        return false;
+    }
+    bins_per_unit = static_cast<int>(count / 2);
+    unit = static_cast<int>(std::lround(*first + bins_per_unit * BIN_SPACING));
+    if (unit < MIN_UNIT || unit > MAX_UNIT) {
+        return false;
+    }
+    for (int bin = 0; first != last; ++first, ++bin) {
+        if (!FloatCompare()(*first, unitBinValue(unit, bins_per_unit, bin))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+double RGAData::unitBinValue(int unit, int bins_per_unit, int bin) {
+    return unit - (double) bins_per_unit * BIN_SPACING + (double) bin * BIN_SPACING;
+}
+
+RGAData::BinIndex RGAData::findBins(const AMUBins& bins) const {
+    int unit, bins_per_unit;
+    if (matchUnitBins(bins.bins.begin(), bins.bins.end(), bins.bins.size(), unit, bins_per_unit)) {
+        auto table = std::find_if(unit_bins_.begin(), unit_bins_.end(),
+            [&bins](const auto& gm_table) { return gm_table.first == bins.GM; });
+        return table == unit_bins_.end() ? NO_BIN : table->second[bins_per_unit * (MAX_UNIT + 1) + unit];
+    }
+    auto it = bin_indices_.find(bins);
+    return it == bin_indices_.end() ? NO_BIN : it->second;
+}
+
+RGAData::BinIndex RGAData::appendBins(const AMUBins& bins) {
+    const BinIndex bin = static_cast<BinIndex>(bins_.size());
+    growStride(bins_.size() + 1);
+    bins_.push_back(bins);
+    return bin;
+}
+
+std::size_t RGAData::findScan(double time) {
+    if (last_scan_ < scan_times_.size() && scan_times_[last_scan_] == time) {
+        return last_scan_;
+    }
+
+    // Scans are expected in time order, so a new scan is appended; an earlier one is inserted in place
+    auto it = std::lower_bound(scan_times_.begin(), scan_times_.end(), time);
+    last_scan_ = static_cast<std::size_t>(it - scan_times_.begin());
+    if (it == scan_times_.end() || *it != time) {
+        scan_times_.insert(it, time);
+        values_.insert(values_.begin() + last_scan_ * stride_, stride_, NO_SAMPLE);
+    }
+    return last_scan_;
+}
+
+void RGAData::setValue(std::size_t scan, BinIndex bin, double value) {
+    double& element = values_[scan * stride_ + bin];
+    if (std::isnan(element)) {
+        // Increment byteSize of object
+        byteSize = byteSize + 16 + static_cast<int>(bins_[bin].bins.size()) * 8; // 8 bytes * 2 + 8 bytes * number of bins
+    }
+    element = value;
+}
+
+void RGAData::growStride(std::size_t bins) {
+    if (bins <= stride_) {
+        return;
+    }
+
+    const std::size_t stride = std::max(bins, 2 * stride_);
+    std::vector<double> values(scan_times_.size() * stride, NO_SAMPLE);
+    for (std::size_t scan = 0; scan < scan_times_.size(); ++scan) {
+        std::copy_n(values_.begin() + scan * stride_, stride_, values.begin() + scan * stride);
+    }
+    values_ = std::move(values);
+    stride_ = stride;
+}
+
+std::vector<std::size_t> RGAData::scansWithSamples(BinIndex bin) const {
+    std::vector<std::size_t> scans;
+    for (std::size_t scan = 0; scan < scan_times_.size(); ++scan) {
+        if (!std::isnan(values_[scan * stride_ + bin])) {
+            scans.push_back(scan);
+        }
+    }
+    return scans;
+}
+
+RGAData RGAData::makeDifference(const std::vector<double>& result) const {
+    RGAData diff_data;
+    diff_data.bins_ = bins_;
+    diff_data.bin_indices_ = bin_indices_;
+    diff_data.unit_bins_ = unit_bins_;
+    diff_data.stride_ = bins_.size();
+
+    const std::size_t bin_count = bins_.size();
+    for (std::size_t scan = 0; scan < scan_times_.size(); ++scan) {
+        const auto row = result.begin() + scan * bin_count;
+        if (std::all_of(row, row + bin_count, [](double value) { return std::isnan(value); })) {
+            continue;
+        }
+        diff_data.scan_times_.push_back(scan_times_[scan]);
+        diff_data.values_.insert(diff_data.values_.end(), row, row + bin_count);
+        for (std::size_t bin = 0; bin < bin_count; ++bin) {
+            if (!std::isnan(row[bin])) {
+                diff_data.byteSize += 16 + static_cast<int>(bins_[bin].bins.size()) * 8;
+            }
+        }
+    }
+
+    return diff_data;
 }
@@ -1,9 +1,15 @@
 #ifndef RGADATA_HPP
 #define RGADATA_HPP
 
+#include <cstdint>
+#include <limits>
+#include <span>
+
 #include "Common.hpp"
 #include "Config.hpp"
+#include "SeriesFingerprint.hpp"
 
+// RGA readings: a table of AMU bins, and a dense scans x bins matrix of values, one row per scan time
 class RGAData {
 public:
     // Custom struct for hash function
@@ -90,25 +96,94 @@ public:
     };
 
 public:
+    using BinIndex = std::uint32_t; // Index into the bin table, stable until the object is destroyed
+
     // Constructors
     RGAData() = default;
     RGAData(const int& bins_per_unit);
 
-    // Getters and Setters
+    // Unit bins: the sets the bins_per_unit constructor generates, bins_per_unit bins 0.1 AMU apart either
+    // side of an integer AMU. Their index is found arithmetically from (unit, bins_per_unit, GM), so
+    // resolving them costs the same whatever the bin width
+    constexpr static int MIN_UNIT = 1;
+    constexpr static int MAX_UNIT = 99;
+    constexpr static int MAX_BINS_PER_UNIT = 9;
+    constexpr static double BIN_SPACING = 0.1;
+
+    // Bins are stored in the bucket as sensor SENSOR_PREFIX + binsString(). Parse such a name back into the
+    // AMU centre of its bins; false if the name is not an RGA bins sensor
+    constexpr static const char* SENSOR_PREFIX = "RGA.";
+    static bool parseSensorName(std::string_view name, double& center);
+
+    // Setters. Resolve bins to a BinIndex once, then add samples by index. Add scans in time order: a new
+    // scan is appended in amortized constant time, an earlier one shifts every later row (O(scans x bins)).
+    // NaN marks a missing sample in the matrix, so a NaN time or value throws instead of being stored
+    BinIndex addBins(const AMUBins& bins); // Index of the bins in the bin table, added if new
+    BinIndex getUnitBins(int unit, int bins_per_unit, const std::string& GM = "Cluster"); // Added if new
+    BinIndex getBinIndex(std::span<const double> bin_values, const std::string& GM = "Cluster"); // Ascending values. Added if new
     void addData(const AMUBins& bins, double time, double value);
+    void addData(BinIndex bin, double time, double value); // Fast path: no bins lookup
+    void reserveScans(std::size_t scans);
+
+    // Getters. Samples are stored as a scans x bins matrix: one row per scan time, one column per bin
+    // table entry, NaN where a scan has no sample for the bins. The spans stay valid until the data is
+    // modified
     int getByteSize() const;
-    const std::unordered_map<AMUBins, std::unordered_map<double, double, std::hash<double>, std::equal_to<double>, std::allocator<std::pair<const double, double>>>, AMUBinsHash, std::equal_to<AMUBins>, std::allocator<std::pair<const AMUBins, std::unordered_map<double, double, std::hash<double>, std::equal_to<double>, std::allocator<std::pair<const double, double>>>>>>& getAllTimeSeriesData() const;
-    const std::vector<AMUBins> getBins();
+    std::size_t getBinCount() const;
+    const AMUBins& getBins(BinIndex bin) const;
+    const std::vector<AMUBins>& getBins() const;
+    std::size_t getScanCount() const;
+    std::span<const double> getScanTimes() const; // Seconds from the Unix epoch, sorted
+    std::span<const double> getScan(std::size_t scan) const; // Indexed by BinIndex
+    std::size_t getSampleCount(BinIndex bin) const;
 
     // Utility
     void printAllTimeSeriesData();
     void printFileAllTimeSeriesData(const Config& config, const std::string& filename);
+    // Drop the samples, keeping the bin table, the row stride and the allocations, so the object can be
+    // refilled as a scan buffer, ingest cycle after ingest cycle, without rebuilding its bin layout
     void clearData();
-    RGAData difference(const RGAData& other) const;
+    // Samples whose time the other object does not have for the same bins. With parallel, scans are
+    // diffed concurrently
+    RGAData difference(const RGAData& other, bool parallel = false) const;
+
+    // The samples that are not in the bucket yet according to the fingerprint (see fingerprintDifference),
+    // and recording samples as uploaded. Bins are fingerprinted under their bucket sensor name
+    constexpr static double FINGERPRINT_WINDOW = 3600; // One hour, in seconds
+    RGAData difference(const SeriesFingerprint& fingerprint, bool parallel = false) const;
+    void addToFingerprint(SeriesFingerprint& fingerprint) const;
     bool is_empty() const;
 
 private:
-    std::unordered_map<AMUBins, std::unordered_map<double, double>, AMUBinsHash> allTimeSeriesData;
+    constexpr static double NO_SAMPLE = std::numeric_limits<double>::quiet_NaN();
+
+    // Unit and bins per unit of the ascending bins set [first, last) of `count` values, if it is a unit bins
+    // set: the ends and the count pick the candidate, then every value is checked against it
+    template<typename BinIt>
+    static bool matchUnitBins(BinIt first, BinIt last, std::size_t count, int& unit, int& bins_per_unit);
+    static double unitBinValue(int unit, int bins_per_unit, int bin); // bin in [0, 2 * bins_per_unit]
+    BinIndex findBins(const AMUBins& bins) const; // Index of the bins, NO_BIN if not in the bin table
+    BinIndex appendBins(const AMUBins& bins);
+
+    std::size_t findScan(double time); // Row of the scan time, inserted if new
+    void setValue(std::size_t scan, BinIndex bin, double value);
+    void growStride(std::size_t bins);
+    std::vector<std::size_t> scansWithSamples(BinIndex bin) const;
+
+    // Build a difference from a scans x bins matrix holding the samples that differ (NaN elsewhere).
+    // Scans left without samples are dropped
+    RGAData makeDifference(const std::vector<double>& result) const;
+
+    std::vector<AMUBins> bins_; // Bin table, indexed by BinIndex
+    std::unordered_map<AMUBins, BinIndex, AMUBinsHash> bin_indices_; // Bins other than unit bins
+    // Unit bins table per GM, indexed by bins_per_unit * (MAX_UNIT + 1) + unit, NO_BIN where not added yet.
+    // There is normally a single GM, so a list beats a map
+    constexpr static BinIndex NO_BIN = std::numeric_limits<BinIndex>::max();
+    std::vector<std::pair<std::string, std::vector<BinIndex>>> unit_bins_;
+    std::vector<double> scan_times_; // Sorted
+    std::vector<double> values_; // Row-major, scan_times_.size() rows of stride_ values
+    std::size_t stride_ = 0; // Row length, at least bins_.size(). Grows by doubling, so new bins rarely move rows
+    std::size_t last_scan_ = 0; // Samples arrive scan by scan, so check it before searching
     int byteSize = 0;
 };
 
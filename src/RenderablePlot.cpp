@@ -12,18 +12,23 @@ RenderablePlot::RenderablePlot(const std::string& label, bool real_time)
 
 // Move constructor
 RenderablePlot::RenderablePlot(RenderablePlot&& other) noexcept
-    : label_(std::move(other.label_)),
-      window_label_(std::move(other.window_label_)),
-      plot_range_(std::move(other.plot_range_)),
+    : window_label_(std::move(other.window_label_)),
+      label_(std::move(other.label_)),
       real_time_(other.real_time_),
-      plot_id_(other.plot_id_),
+      plot_range_(std::move(other.plot_range_)),
       data_(std::move(other.data_)),
+      range_callback_(std::move(other.range_callback_)),
+      plot_id_(other.plot_id_),
+      real_time_plot_range_hour_(other.real_time_plot_range_hour_),
+      real_time_plot_range_minute_(other.real_time_plot_range_minute_),
+      plot_type_(other.plot_type_),
+      data_versions_(std::move(other.data_versions_)),
+      next_data_version_(other.next_data_version_),
+      primary_x_axis_(other.primary_x_axis_),
       data_to_y_axis_(std::move(other.data_to_y_axis_)),
       y_axis_labels_(std::move(other.y_axis_labels_)),
-      primary_x_axis_(other.primary_x_axis_),
       y_axis_properties_(std::move(other.y_axis_properties_)),
-      data_to_plotline_properties_(std::move(other.data_to_plotline_properties_)),
-      range_callback_(std::move(other.range_callback_)) {}
+      data_to_plotline_properties_(std::move(other.data_to_plotline_properties_)) {}
 
 // Move assignment operator
 RenderablePlot& RenderablePlot::operator=(RenderablePlot&& other) noexcept {
@@ -34,7 +39,12 @@ RenderablePlot& RenderablePlot::operator=(RenderablePlot&& other) noexcept {
         plot_range_ = std::move(other.plot_range_);
         real_time_ = other.real_time_;
         plot_id_ = other.plot_id_;
+        real_time_plot_range_hour_ = other.real_time_plot_range_hour_;
+        real_time_plot_range_minute_ = other.real_time_plot_range_minute_;
+        plot_type_ = other.plot_type_;
         data_ = std::move(other.data_);
+        data_versions_ = std::move(other.data_versions_);
+        next_data_version_ = std::max(next_data_version_, other.next_data_version_);
         data_to_y_axis_ = std::move(other.data_to_y_axis_);
         y_axis_labels_ = std::move(other.y_axis_labels_);
         primary_x_axis_ = other.primary_x_axis_;
@@ -75,6 +85,10 @@ void RenderablePlot::setRealTimeRangeMinute(int minute) {
     real_time_plot_range_minute_ = minute;
 }
 
+void RenderablePlot::setPlotType(PlotType plot_type) {
+    plot_type_ = plot_type;
+}
+
 const std::string& RenderablePlot::getLabel() const {
     return label_;
 }
@@ -105,8 +119,8 @@ void RenderablePlot::print() const {
     std::cout << "Real-time: " << real_time_ << "\n";
     std::cout << "Plot range: " << plot_range_.first << " - " << plot_range_.second << "\n";
     std::cout << "Data: " << "\n";
-    for (const auto& [series_label, data] : data_) {
-        std::cout << "Series: " << series_label << "\n";
+    for (const auto& [sensor, data] : data_) {
+        std::cout << "Series: " << SensorRegistry::getLabel(sensor) << "\n";
 
         // Print all data points
         for (const auto& [timestamp, value] : data) {
@@ -116,7 +130,11 @@ void RenderablePlot::print() const {
 }
 
 const std::vector<std::string> RenderablePlot::getAllSensors() const {
-    std::vector<std::string> sensors;
+    return SensorRegistry::getLabels(getAllSensorHandles());
+}
+
+std::vector<SensorHandle> RenderablePlot::getAllSensorHandles() const {
+    std::vector<SensorHandle> sensors;
     // Pre-allocate space
     sensors.reserve(data_.size());
 
@@ -134,36 +152,56 @@ int& RenderablePlot::getRealTimeRangeMinute() {
     return real_time_plot_range_minute_;
 }
 
+RenderablePlot::PlotType RenderablePlot::getPlotType() const {
+    return plot_type_;
+}
+
 
 // ============================================
 // Data Management
 // ============================================
 void RenderablePlot::setData(const std::string& series_label, const RenderablePlot::DataSeries& data) {
+    setData(SensorRegistry::intern(series_label), data);
+}
+
+void RenderablePlot::setData(SensorHandle sensor, const RenderablePlot::DataSeries& data) {
     // Lock the mutex
     std::lock_guard<std::mutex> lock(data_mutex_);
-    data_[series_label] = data;
+    data_[sensor] = data;
+    data_versions_[sensor] = ++next_data_version_;
 }
 
 void RenderablePlot::setAllData(const std::map<std::string, RenderablePlot::DataSeries> data) {
     // Lock the mutex
     std::lock_guard<std::mutex> lock(data_mutex_);
-    data_ = data;
+    data_.clear();
+    data_versions_.clear();
+    ++next_data_version_;
+    for (const auto& [series_label, series] : data) {
+        const SensorHandle sensor = SensorRegistry::intern(series_label);
+        data_[sensor] = series;
+        data_versions_[sensor] = next_data_version_;
+    }
 }
 
 // UNSAFE ACCESS
 const RenderablePlot::DataSeries& RenderablePlot::getData(const std::string& sensor) const {
-    return data_.at(sensor);
+    return data_.at(SensorRegistry::find(sensor));
 }
 
 // UNSAFE ACCESS
 const std::map<std::string, RenderablePlot::DataSeries> RenderablePlot::getAllData() const {
-    return data_;
+    std::map<std::string, DataSeries> data;
+    for (const auto& [sensor, series] : data_) {
+        data.emplace(SensorRegistry::getLabel(sensor), series);
+    }
+    return data;
 }
 
 // SAFE ACCESS
 RenderablePlot::DataSeries RenderablePlot::getDataSnapshot(const std::string& series_label) {
     std::lock_guard<std::mutex> lock(data_mutex_);
-    auto it = data_.find(series_label);
+    auto it = data_.find(SensorRegistry::find(series_label));
     if (it != data_.end()) {
         return it->second;
     }
@@ -171,11 +209,42 @@ RenderablePlot::DataSeries RenderablePlot::getDataSnapshot(const std::string& se
     return DataSeries();
 }
 
+// SAFE ACCESS. Only covers the points in [start, end] plus one neighbour on each side
+// so that lines still reach the edges of the plot
+RenderablePlot::DataSeries RenderablePlot::getDataSnapshot(const std::string& series_label, SensorTimestamp start, SensorTimestamp end) {
+    return getDataSnapshot(SensorRegistry::find(series_label), start, end);
+}
+
+// SAFE ACCESS
+RenderablePlot::DataSeries RenderablePlot::getDataSnapshot(SensorHandle sensor, SensorTimestamp start, SensorTimestamp end) {
+    std::lock_guard<std::mutex> lock(data_mutex_);
+    auto it = data_.find(sensor);
+    if (it == data_.end()) {
+        return DataSeries();
+    }
+    return it->second.slice(start, end, true);
+}
+
+// SAFE ACCESS
+std::uint64_t RenderablePlot::getDataVersion(const std::string& series_label) {
+    return getDataVersion(SensorRegistry::find(series_label));
+}
+
+// SAFE ACCESS
+std::uint64_t RenderablePlot::getDataVersion(SensorHandle sensor) {
+    std::lock_guard<std::mutex> lock(data_mutex_);
+    auto it = data_versions_.find(sensor);
+    if (it != data_versions_.end()) {
+        return it->second;
+    }
+    return 0;
+}
+
 std::vector<std::string> RenderablePlot::getSensorsForYAxis(ImAxis y_axis) const {
     std::vector<std::string> sensors;
     for (const auto& [sensor, axis] : data_to_y_axis_) {
         if (axis == y_axis) {
-            sensors.push_back(sensor);
+            sensors.push_back(SensorRegistry::getLabel(sensor));
         }
     }
     return sensors;
@@ -187,11 +256,15 @@ std::vector<std::string> RenderablePlot::getSensorsForYAxis(ImAxis y_axis) const
 // Multiple axis support
 // ============================================
 void RenderablePlot::addYAxisForSensor(const std::string& series_label, ImAxis y_axis) {
-    data_to_y_axis_[series_label] = y_axis;
+    data_to_y_axis_[SensorRegistry::intern(series_label)] = y_axis;
 }
 
 ImAxis RenderablePlot::getYAxisForSensor(const std::string& series_label) const {
-    auto it = data_to_y_axis_.find(series_label);
+    return getYAxisForSensor(SensorRegistry::find(series_label));
+}
+
+ImAxis RenderablePlot::getYAxisForSensor(SensorHandle sensor) const {
+    auto it = data_to_y_axis_.find(sensor);
     if (it != data_to_y_axis_.end()) {
         return it->second;
     }
@@ -200,9 +273,7 @@ ImAxis RenderablePlot::getYAxisForSensor(const std::string& series_label) const
 }
 
 void RenderablePlot::deleteYAxisForSensor(const std::string& series_label) {
-    if (data_to_y_axis_.find(series_label) != data_to_y_axis_.end()) {
-        data_to_y_axis_.erase(series_label);
-    }
+    data_to_y_axis_.erase(SensorRegistry::find(series_label));
 }
 
 void RenderablePlot::clearYAxes() {
@@ -299,7 +370,7 @@ std::string RenderablePlot::getYAxisLabel(ImAxis y_axis) const {
 std::vector<std::string> RenderablePlot::getAllSensorLabels() const {
     std::vector<std::string> sensors;
     for (const auto& [sensor, _] : data_to_y_axis_) {
-        sensors.push_back(sensor);
+        sensors.push_back(SensorRegistry::getLabel(sensor));
     }
     return sensors;
 }
@@ -311,16 +382,17 @@ std::vector<std::string> RenderablePlot::getAllSensorLabels() const {
 // UNSAFE BECAUSE IT DOES NOT CHECK IF PROPERTIES ARE VALID
 void RenderablePlot::setPlotLineProperties(const std::string& series_label, const PlotLineProperties& properties) {
     // Check if the series label exists
-    if (data_to_plotline_properties_.find(series_label) == data_to_plotline_properties_.end()) {
+    auto it = data_to_plotline_properties_.find(SensorRegistry::find(series_label));
+    if (it == data_to_plotline_properties_.end()) {
         // Series label does not exist
         return;
     }
-    data_to_plotline_properties_[series_label] = properties;
+    it->second = properties;
 }
 
 // UNSAFE BECAUSE IT DOES NOT CHECK IF PROPERTIES ARE VALID. OKAY TO USE IF INPUTTING DEFAULT PROPERTIES
 void RenderablePlot::addPlotLineProperties(const std::string& series_label, const PlotLineProperties& properties) {
-    data_to_plotline_properties_[series_label] = properties;
+    data_to_plotline_properties_[SensorRegistry::intern(series_label)] = properties;
 }
 
 void RenderablePlot::setPlotLinePropertiesColour(const std::string& series_label, ImVec4 colour) {
@@ -352,7 +424,7 @@ void RenderablePlot::setPlotLinePropertiesColour(const std::string& series_label
         colour.w = 0;
     }
 
-    data_to_plotline_properties_[series_label].colour = colour;
+    data_to_plotline_properties_[SensorRegistry::intern(series_label)].colour = colour;
 }
 
 void RenderablePlot::setPlotLinePropertiesThickness(const std::string& series_label, double thickness) {
@@ -362,10 +434,10 @@ void RenderablePlot::setPlotLinePropertiesThickness(const std::string& series_la
         return;
     } else if (thickness > 10) {
         // Thickness is capped at 10
-        data_to_plotline_properties_[series_label].thickness = 10;
+        data_to_plotline_properties_[SensorRegistry::intern(series_label)].thickness = 10;
         return;
     }
-    data_to_plotline_properties_[series_label].thickness = thickness;
+    data_to_plotline_properties_[SensorRegistry::intern(series_label)].thickness = thickness;
 }
 
 void RenderablePlot::setPlotLinePropertiesMarkerStyle(const std::string& series_label, ImPlotMarker marker_style) {
@@ -374,7 +446,7 @@ void RenderablePlot::setPlotLinePropertiesMarkerStyle(const std::string& series_
         // Invalid marker style values are ignored
         return;
     }
-    data_to_plotline_properties_[series_label].marker_style = marker_style;
+    data_to_plotline_properties_[SensorRegistry::intern(series_label)].marker_style = marker_style;
 }
 
 void RenderablePlot::setPlotLinePropertiesMarkerSize(const std::string& series_label, double marker_size) {
@@ -384,10 +456,10 @@ void RenderablePlot::setPlotLinePropertiesMarkerSize(const std::string& series_l
         return;
     } else if (marker_size > 5) {
         // Marker size is capped at 5
-        data_to_plotline_properties_[series_label].marker_size = 5;
+        data_to_plotline_properties_[SensorRegistry::intern(series_label)].marker_size = 5;
         return;
     }
-    data_to_plotline_properties_[series_label].marker_size = marker_size;
+    data_to_plotline_properties_[SensorRegistry::intern(series_label)].marker_size = marker_size;
 }
 
 void RenderablePlot::setPlotLinePropertiesFill(const std::string& series_label, ImVec4 fill) {
@@ -396,7 +468,7 @@ void RenderablePlot::setPlotLinePropertiesFill(const std::string& series_label,
         // Invalid fill color values are ignored
         return;
     }
-    data_to_plotline_properties_[series_label].fill = fill;
+    data_to_plotline_properties_[SensorRegistry::intern(series_label)].fill = fill;
 }
 
 void RenderablePlot::setPlotLinePropertiesFillWeight(const std::string& series_label, double fill_weight) {
@@ -406,10 +478,10 @@ void RenderablePlot::setPlotLinePropertiesFillWeight(const std::string& series_l
         return;
     } else if (fill_weight > 10) {
         // Fill weight is capped at 10
-        data_to_plotline_properties_[series_label].fill_weight = 5;
+        data_to_plotline_properties_[SensorRegistry::intern(series_label)].fill_weight = 5;
         return;
     }
-    data_to_plotline_properties_[series_label].fill_weight = fill_weight;
+    data_to_plotline_properties_[SensorRegistry::intern(series_label)].fill_weight = fill_weight;
 }
 
 void RenderablePlot::setPlotLinePropertiesFillOutline(const std::string& series_label, ImVec4 fill_outline) {
@@ -418,79 +490,96 @@ void RenderablePlot::setPlotLinePropertiesFillOutline(const std::string& series_
         // Invalid fill outline color values are ignored
         return;
     }
-    data_to_plotline_properties_[series_label].fill_outline = fill_outline;
+    data_to_plotline_properties_[SensorRegistry::intern(series_label)].fill_outline = fill_outline;
 }
 
 std::map<std::string, RenderablePlot::PlotLineProperties> RenderablePlot::getAllPlotLineProperties() const {
-    return data_to_plotline_properties_;
+    std::map<std::string, PlotLineProperties> properties;
+    for (const auto& [sensor, sensor_properties] : data_to_plotline_properties_) {
+        properties.emplace(SensorRegistry::getLabel(sensor), sensor_properties);
+    }
+    return properties;
+}
+
+// Hot path for rendering: no label lookup and no copy. Sensors without properties get the defaults
+const RenderablePlot::PlotLineProperties& RenderablePlot::getPlotLineProperties(SensorHandle sensor) const {
+    static const PlotLineProperties default_properties;
+    auto it = data_to_plotline_properties_.find(sensor);
+    return it != data_to_plotline_properties_.end() ? it->second : default_properties;
 }
 
 RenderablePlot::PlotLineProperties RenderablePlot::getPlotLineProperties(const std::string& series_label) {
-    if (data_to_plotline_properties_.find(series_label) == data_to_plotline_properties_.end()) {
+    auto it = data_to_plotline_properties_.find(SensorRegistry::find(series_label));
+    if (it == data_to_plotline_properties_.end()) {
         return PlotLineProperties();
     }
-    return data_to_plotline_properties_.at(series_label);
+    return it->second;
 }
 
 ImVec4 RenderablePlot::getPlotLinePropertiesColour(const std::string& series_label) const {
-    if (data_to_plotline_properties_.find(series_label) == data_to_plotline_properties_.end()) {
+    auto it = data_to_plotline_properties_.find(SensorRegistry::find(series_label));
+    if (it == data_to_plotline_properties_.end()) {
         return ImVec4(1, 1, 1, 1);
     }
-    return data_to_plotline_properties_.at(series_label).colour;
+    return it->second.colour;
 }
 
 double RenderablePlot::getPlotLinePropertiesThickness(const std::string& series_label) const {
-    if (data_to_plotline_properties_.find(series_label) == data_to_plotline_properties_.end()) {
+    auto it = data_to_plotline_properties_.find(SensorRegistry::find(series_label));
+    if (it == data_to_plotline_properties_.end()) {
         return 1.0;
     }
-    return data_to_plotline_properties_.at(series_label).thickness;
+    return it->second.thickness;
 }
 
 ImPlotMarker RenderablePlot::getPlotLinePropertiesMarkerStyle(const std::string& series_label) const {
-    if (data_to_plotline_properties_.find(series_label) == data_to_plotline_properties_.end()) {
+    auto it = data_to_plotline_properties_.find(SensorRegistry::find(series_label));
+    if (it == data_to_plotline_properties_.end()) {
         return ImPlotMarker_None;
     }
-    return data_to_plotline_properties_.at(series_label).marker_style;
+    return it->second.marker_style;
 }
 
 double RenderablePlot::getPlotLinePropertiesMarkerSize(const std::string& series_label) const {
-    if (data_to_plotline_properties_.find(series_label) == data_to_plotline_properties_.end()) {
+    auto it = data_to_plotline_properties_.find(SensorRegistry::find(series_label));
+    if (it == data_to_plotline_properties_.end()) {
         return 1.0;
     }
-    return data_to_plotline_properties_.at(series_label).marker_size;
+    return it->second.marker_size;
 }
 
 ImVec4 RenderablePlot::getPlotLinePropertiesFill(const std::string& series_label) const {
-    if (data_to_plotline_properties_.find(series_label) == data_to_plotline_properties_.end()) {
+    auto it = data_to_plotline_properties_.find(SensorRegistry::find(series_label));
+    if (it == data_to_plotline_properties_.end()) {
         return ImVec4(1, 1, 1, 1);
     }
-    return data_to_plotline_properties_.at(series_label).fill;
+    return it->second.fill;
 }
 
 double RenderablePlot::getPlotLinePropertiesFillWeight(const std::string& series_label) const {
-    if (data_to_plotline_properties_.find(series_label) == data_to_plotline_properties_.end()) {
+    auto it = data_to_plotline_properties_.find(SensorRegistry::find(series_label));
+    if (it == data_to_plotline_properties_.end()) {
         return 1.0;
     }
-    return data_to_plotline_properties_.at(series_label).fill_weight;
+    return it->second.fill_weight;
 }
 
 ImVec4 RenderablePlot::getPlotLinePropertiesFillOutline(const std::string& series_label) const {
-    if (data_to_plotline_properties_.find(series_label) == data_to_plotline_properties_.end()) {
+    auto it = data_to_plotline_properties_.find(SensorRegistry::find(series_label));
+    if (it == data_to_plotline_properties_.end()) {
         return ImVec4(1, 1, 1, 1);
     }
-    return data_to_plotline_properties_.at(series_label).fill_outline;
+    return it->second.fill_outline;
 }
 
 void RenderablePlot::resetPlotLineProperties(const std::string& series_label) {
-    data_to_plotline_properties_[series_label].reset();
+    data_to_plotline_properties_[SensorRegistry::intern(series_label)].reset();
 }
 
 void RenderablePlot::removePlotLineProperties(const std::string& series_label) {
-    if (data_to_plotline_properties_.find(series_label) != data_to_plotline_properties_.end()) {
-        data_to_plotline_properties_.erase(series_label);
-    }
+    data_to_plotline_properties_.erase(SensorRegistry::find(series_label));
 }
 
 bool RenderablePlot::hasPlotLineProperties(const std::string& series_label) {
-    return data_to_plotline_properties_.find(series_label) != data_to_plotline_properties_.end();
+    return data_to_plotline_properties_.find(SensorRegistry::find(series_label)) != data_to_plotline_properties_.end();
 }
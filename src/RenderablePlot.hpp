@@ -6,6 +6,11 @@
 #include <functional>
 #include <implot.h>
 #include <mutex>
+#include <atomic>
+#include <cstdint>
+
+#include "TimeSeriesBuffer.hpp"
+#include "SensorRegistry.hpp"
 
 class RenderablePlot {
 public:
@@ -19,10 +24,14 @@ public:
     };
 
 public:
-    using Timestamp = double;
+    using Timestamp = double; // Plot (ImPlot) time axis, in seconds
     using Value = double;
     using RangeCallback = std::function<void(Timestamp start, Timestamp end)>;
-    using DataSeries = std::vector<std::pair<Timestamp, Value>>;
+    using DataSeries = TimeSeriesRangeView<SensorTimestamp, SensorValue>; // Shared, immutable view of a buffer range
+    enum class PlotType {
+        Line, // Time-series of the plot's sensors
+        Spectrogram // Time x AMU image of all RGA bins
+    };
 
     // Constructor
     RenderablePlot(const std::string& label, bool real_time = true);
@@ -43,6 +52,7 @@ public:
     void setPlotId(long long id);
     void setRealTimeRangeHour(int hour);
     void setRealTimeRangeMinute(int day);
+    void setPlotType(PlotType plot_type);
 
     // Getters
     const std::string& getLabel() const;
@@ -51,8 +61,10 @@ public:
     bool isRealTime() const;
     long long getPlotId() const;
     const std::vector<std::string> getAllSensors() const;
+    std::vector<SensorHandle> getAllSensorHandles() const;
     int& getRealTimeRangeHour();
     int& getRealTimeRangeMinute();
+    PlotType getPlotType() const;
 
     // Print object
     void print() const;
@@ -60,11 +72,17 @@ public:
     // ============================================
     // Data Management
     // ============================================
+    // The SensorHandle overloads are the hot path used every frame; the label overloads are for the UI
     void setData(const std::string& series_label, const DataSeries& data);
+    void setData(SensorHandle sensor, const DataSeries& data);
     void setAllData(const std::map<std::string, DataSeries> data);
     const DataSeries& getData(const std::string& series_label) const; // UNSAFE ACCESS
     const std::map<std::string, DataSeries> getAllData() const;
     DataSeries getDataSnapshot(const std::string& series_label); // SAFE ACCESS
+    DataSeries getDataSnapshot(const std::string& series_label, SensorTimestamp start, SensorTimestamp end); // SAFE ACCESS
+    DataSeries getDataSnapshot(SensorHandle sensor, SensorTimestamp start, SensorTimestamp end); // SAFE ACCESS
+    std::uint64_t getDataVersion(const std::string& series_label); // SAFE ACCESS. Increases on every setData
+    std::uint64_t getDataVersion(SensorHandle sensor); // SAFE ACCESS
 
 
 
@@ -102,6 +120,7 @@ public:
     };
     void addYAxisForSensor(const std::string& series_label, ImAxis y_axis);
     ImAxis getYAxisForSensor(const std::string& series_label) const;
+    ImAxis getYAxisForSensor(SensorHandle sensor) const;
     std::vector<std::string> getSensorsForYAxis(ImAxis y_axis) const;
     void deleteYAxisForSensor(const std::string& series_label);
     void clearYAxes();
@@ -155,6 +174,7 @@ public:
     void setPlotLinePropertiesFillWeight(const std::string& series_label, double fill_weight);
     void setPlotLinePropertiesFillOutline(const std::string& series_label, ImVec4 fill_outline);
     PlotLineProperties getPlotLineProperties(const std::string& series_label);
+    const PlotLineProperties& getPlotLineProperties(SensorHandle sensor) const;
     std::map<std::string, PlotLineProperties> getAllPlotLineProperties() const;
     ImVec4 getPlotLinePropertiesColour(const std::string& series_label) const;
     double getPlotLinePropertiesThickness(const std::string& series_label) const;
@@ -177,28 +197,31 @@ private:
     std::string label_; // Plot label
     bool real_time_;    // Real-time plotting flag
     std::pair<Timestamp, Timestamp> plot_range_; // Plot range
-    std::map<std::string, DataSeries> data_; // Data for each sensor and corresponding time-series
+    std::map<SensorHandle, DataSeries> data_; // Data for each sensor and corresponding time-series
     RangeCallback range_callback_; // Callback for range changes
     long long plot_id_;
     int real_time_plot_range_hour_ = 0; // Real-time plot range in hours
     int real_time_plot_range_minute_ = 15; // Real-time plot range in minutes
+    PlotType plot_type_ = PlotType::Line;
 
     // ============================================
     // Data Management
     // ============================================
     std::mutex data_mutex_;
+    std::map<SensorHandle, std::uint64_t> data_versions_; // Data version for each sensor
+    std::uint64_t next_data_version_ = 0;
 
     // ============================================
     // Multiple axis support
     // ============================================
     ImAxis primary_x_axis_ = ImAxis_X1;
-    std::map<std::string, ImAxis> data_to_y_axis_;
+    std::map<SensorHandle, ImAxis> data_to_y_axis_;
     std::map<ImAxis, std::string> y_axis_labels_;
     std::map<ImAxis, YAxisProperties> y_axis_properties_;
 
     // ============================================
     // Plotline properties
     // ============================================
-    std::map<std::string, PlotLineProperties> data_to_plotline_properties_;
+    std::map<SensorHandle, PlotLineProperties> data_to_plotline_properties_;
 
 };
@@ -0,0 +1,193 @@
+#include <algorithm>
+#include <tuple>
+#include <iterator>
+#include <charconv>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+
+#include "SensorCatalogue.hpp"
+
+std::size_t SensorCatalogue::insert(std::vector<Sensor> sensors) {
+    // Sort the batch and drop duplicate and already known sensors
+    std::sort(sensors.begin(), sensors.end(), [](const Sensor& a, const Sensor& b) {
+        return std::tie(a.name, a.machine) < std::tie(b.name, b.machine);
+    });
+    sensors.erase(std::unique(sensors.begin(), sensors.end(), [](const Sensor& a, const Sensor& b) {
+        return a.name == b.name && a.machine == b.machine;
+    }), sensors.end());
+
+    const std::size_t old_size = entries_.size();
+    auto by_key = [this](const Entry& entry, const Sensor& key) { return less(entry, key.name, key.machine); };
+    for (auto& sensor : sensors) {
+        // Only the old entries are sorted while new ones are appended
+        auto known = std::lower_bound(entries_.begin(), entries_.begin() + old_size, sensor, by_key);
+        if (known != entries_.begin() + old_size && known->name == sensor.name && getMachine(*known) == sensor.machine) {
+            continue;
+        }
+        long long id = 0;
+        const char* id_end = sensor.id.data() + sensor.id.size();
+        if (std::from_chars(sensor.id.data(), id_end, id).ptr == id_end && !sensor.id.empty()) {
+            watermark_ = std::max(watermark_, id);
+        }
+        const std::uint32_t machine = internMachine(sensor.machine);
+        entries_.push_back({std::move(sensor.name), std::move(sensor.id), machine});
+    }
+
+    // Both runs are sorted, so a merge restores the order in O(n)
+    std::inplace_merge(entries_.begin(), entries_.begin() + old_size, entries_.end(),
+        [this](const Entry& a, const Entry& b) { return less(a, b.name, getMachine(b)); });
+    return entries_.size() - old_size;
+}
+
+// File format: a header line "SENSOR_CATALOGUE 1 <watermark>", then one "name<TAB>id<TAB>machine" line per sensor
+bool SensorCatalogue::load(const std::string& path) {
+    std::ifstream file(path);
+    if (!file) {
+        return false;
+    }
+
+    std::string line;
+    std::getline(file, line);
+    const std::string header = FILE_HEADER;
+    if (line.compare(0, header.size(), header) != 0) {
+        std::cerr << "SensorCatalogue: " << path << " is not a sensor catalogue, ignoring it\n";
+        return false;
+    }
+    long long watermark = -1;
+    std::istringstream(line.substr(header.size())) >> watermark;
+
+    std::vector<Sensor> sensors;
+    while (std::getline(file, line)) {
+        const std::size_t first_tab = line.find('\t');
+        const std::size_t second_tab = line.find('\t', first_tab + 1);
+        if (first_tab == std::string::npos || second_tab == std::string::npos) {
+            continue;
+        }
+        sensors.push_back({
+            .name = line.substr(0, first_tab),
+            .id = line.substr(first_tab + 1, second_tab - first_tab - 1),
+            .machine = line.substr(second_tab + 1)
+        });
+    }
+
+    insert(std::move(sensors));
+    watermark_ = std::max(watermark_, watermark);
+    return true;
+}
+
+bool SensorCatalogue::save(const std::string& path) const {
+    // Write a temporary file and rename it, so a crash never leaves a truncated catalogue behind
+    const std::string temporary_path = path + ".tmp";
+    {
+        std::ofstream file(temporary_path, std::ios::trunc);
+        if (!file) {
+            std::cerr << "SensorCatalogue: cannot write " << temporary_path << "\n";
+            return false;
+        }
+        file << FILE_HEADER << " " << watermark_ << "\n";
+        for (const auto& entry : entries_) {
+            if (entry.id.empty()) {
+                continue; // Not from the ns table
+            }
+            file << entry.name << '\t' << entry.id << '\t' << machines_[entry.machine] << '\n';
+        }
+        if (!file) {
+            std::cerr << "SensorCatalogue: error writing " << temporary_path << "\n";
+            return false;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temporary_path, path, error);
+    if (error) {
+        std::cerr << "SensorCatalogue: cannot replace " << path << ": " << error.message() << "\n";
+        return false;
+    }
+    return true;
+}
+
+long long SensorCatalogue::getWatermark() const {
+    return watermark_;
+}
+
+std::string SensorCatalogue::getLabel(const Entry& entry) const {
+    if (getMachine(entry).empty() || !isShared(static_cast<std::size_t>(&entry - entries_.data()))) {
+        return entry.name;
+    }
+    return entry.name + " (" + getMachine(entry) + ")";
+}
+
+const SensorCatalogue::Entry* SensorCatalogue::find(std::string_view label) const {
+    // A name, found as the sensor of its first machine
+    auto it = std::lower_bound(entries_.begin(), entries_.end(), label,
+        [](const Entry& entry, std::string_view key) { return entry.name < key; });
+    if (it != entries_.end() && it->name == label) {
+        return &*it;
+    }
+
+    // "name (machine)"
+    const std::size_t machine_start = label.rfind(" (");
+    if (machine_start == std::string_view::npos || !label.ends_with(')')) {
+        return nullptr;
+    }
+    return find(label.substr(0, machine_start), label.substr(machine_start + 2, label.size() - machine_start - 3));
+}
+
+const SensorCatalogue::Entry* SensorCatalogue::find(std::string_view name, std::string_view machine) const {
+    auto it = std::lower_bound(entries_.begin(), entries_.end(), name,
+        [this, machine](const Entry& entry, std::string_view key) { return less(entry, key, machine); });
+    if (it == entries_.end() || it->name != name || getMachine(*it) != machine) {
+        return nullptr;
+    }
+    return &*it;
+}
+
+const std::string& SensorCatalogue::getMachine(const Entry& entry) const {
+    return machines_.at(entry.machine);
+}
+
+const std::vector<SensorCatalogue::Entry>& SensorCatalogue::getEntries() const {
+    return entries_;
+}
+
+std::vector<std::string> SensorCatalogue::getLabels() const {
+    std::vector<std::string> labels;
+    labels.reserve(entries_.size());
+    for (const auto& entry : entries_) {
+        labels.push_back(getLabel(entry));
+    }
+    // A label with its machine added can sort after longer names
+    std::sort(labels.begin(), labels.end());
+    return labels;
+}
+
+std::size_t SensorCatalogue::size() const {
+    return entries_.size();
+}
+
+bool SensorCatalogue::empty() const {
+    return entries_.empty();
+}
+
+bool SensorCatalogue::less(const Entry& entry, std::string_view name, std::string_view machine) const {
+    if (entry.name != name) {
+        return entry.name < name;
+    }
+    return getMachine(entry) < machine;
+}
+
+bool SensorCatalogue::isShared(std::size_t index) const {
+    return (index > 0 && entries_[index - 1].name == entries_[index].name) ||
+        (index + 1 < entries_.size() && entries_[index + 1].name == entries_[index].name);
+}
+
+std::uint32_t SensorCatalogue::internMachine(const std::string& machine) {
+    auto it = std::find(machines_.begin(), machines_.end(), machine);
+    if (it != machines_.end()) {
+        return static_cast<std::uint32_t>(it - machines_.begin());
+    }
+    machines_.push_back(machine);
+    return static_cast<std::uint32_t>(machines_.size() - 1);
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// Index of all known sensors (name, InfluxDB sensor id and machine), keyed by machine and name like the ns
+// table, and sorted by name. Holds no data and no per-sensor objects beyond the entry itself, so it stays
+// cheap with thousands of sensors (e.g. RGA bins). Not thread safe: DataManager publishes immutable
+// catalogues and replaces them as a whole
+class SensorCatalogue {
+public:
+    // Sensor as read from the ns table
+    struct Sensor {
+        std::string name;
+        std::string id;
+        std::string machine;
+    };
+
+    struct Entry {
+        std::string name;
+        std::string id;
+        std::uint32_t machine; // Index into machines_. Sensors share a handful of machines
+    };
+
+    // Add sensors. Sensors (machine and name) already in the catalogue keep their entry. Returns the number
+    // of sensors added
+    std::size_t insert(std::vector<Sensor> sensors);
+
+    // Local cache of the ns table. Only sensors with an id are saved. load returns false (leaving the
+    // catalogue unchanged) if the file is missing or not a catalogue; save returns false on write errors
+    bool load(const std::string& path);
+    bool save(const std::string& path) const;
+
+    // Highest numeric sensor id seen, or -1. The ns table assigns ids in increasing order and all its rows
+    // share one timestamp, so the id (not the time) tells which rows are newer than the catalogue
+    long long getWatermark() const;
+
+    // Sensors are shown by label: the name, or "name (machine)" for a name several machines have.
+    // find takes a label, and a bare name several machines have finds the sensor of the first machine
+    std::string getLabel(const Entry& entry) const;
+    const Entry* find(std::string_view label) const; // nullptr if not found. O(log n)
+    const Entry* find(std::string_view name, std::string_view machine) const; // nullptr if not found. O(log n)
+    const std::string& getMachine(const Entry& entry) const;
+    const std::vector<Entry>& getEntries() const; // Sorted by name, then machine
+    std::vector<std::string> getLabels() const; // Sorted
+    std::size_t size() const;
+    bool empty() const;
+
+private:
+    std::uint32_t internMachine(const std::string& machine);
+    bool less(const Entry& entry, std::string_view name, std::string_view machine) const; // Entry order
+    bool isShared(std::size_t index) const; // Whether a neighbour of entries_[index] has the same name
+
+    constexpr static const char* FILE_HEADER = "SENSOR_CATALOGUE 1";
+
+    std::vector<Entry> entries_; // Sorted by name, then machine, unique
+    std::vector<std::string> machines_;
+    long long watermark_ = -1;
+};
@@ -0,0 +1,49 @@
+#include <iostream>
+#include <stdexcept>
+#include <algorithm>
+#include <iterator>
+#include <utility>
+
+#include "SensorIdResolver.hpp"
+
+void SensorIdResolver::addExisting(const std::string& name, const std::string& machine, const std::string& id) {
+    long long sensor_id;
+    try {
+        sensor_id = std::stoll(id);
+    } catch (std::exception& e) {
+        std::cerr << "Error in SensorIdResolver::addExisting call: error parsing sensor_id \"" << id << "\"\n";
+        throw std::runtime_error("Error in SensorIdResolver::addExisting call: error parsing sensor_id\n");
+    }
+    ids_[key(name, machine)] = sensor_id;
+    next_id_ = std::max(next_id_, sensor_id + 1);
+}
+
+long long SensorIdResolver::resolve(const std::string& name, const std::string& machine) {
+    auto [it, inserted] = ids_.try_emplace(key(name, machine), next_id_);
+    if (inserted) {
+        new_sensors_.push_back({machine, name, next_id_});
+        ++next_id_;
+    }
+    return it->second;
+}
+
+std::vector<SensorIdResolver::NewSensor> SensorIdResolver::takeNewSensors() {
+    return std::exchange(new_sensors_, {});
+}
+
+void SensorIdResolver::requeueNewSensors(std::vector<NewSensor> sensors) {
+    new_sensors_.insert(new_sensors_.end(), std::make_move_iterator(sensors.begin()), std::make_move_iterator(sensors.end()));
+}
+
+std::size_t SensorIdResolver::size() const {
+    return ids_.size();
+}
+
+// Machine and sensor names joined by a character neither of them contains
+std::string SensorIdResolver::key(const std::string& name, const std::string& machine) {
+    std::string result;
+    result.reserve(machine.size() + 1 + name.size());
+    result.append(machine).push_back('\0');
+    result.append(name);
+    return result;
+}
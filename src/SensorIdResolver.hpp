@@ -0,0 +1,36 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+// In-memory index of the ns table ((machine, sensor name) -> sensor_id) used while importing data. Ids are
+// unique across machines, so sensors of different machines sharing a name get their own ids. Unknown sensors get
+// the next free id locally and are queued, so a whole import costs one ns read and one batched ns write
+// instead of queries per sensor
+class SensorIdResolver {
+public:
+    struct NewSensor {
+        std::string machine;
+        std::string name;
+        long long id;
+    };
+
+    // Add a row read from the ns table. Throws std::runtime_error if the id is not a number
+    void addExisting(const std::string& name, const std::string& machine, const std::string& id);
+
+    // Id of the sensor of the machine. Unknown sensors are assigned the next free id and queued as new sensors
+    long long resolve(const std::string& name, const std::string& machine);
+
+    // Take the sensors queued so far, leaving the queue empty. Sensors whose ns write failed are put back
+    // with requeueNewSensors, so a later write picks them up
+    std::vector<NewSensor> takeNewSensors();
+    void requeueNewSensors(std::vector<NewSensor> sensors);
+    std::size_t size() const;
+
+private:
+    static std::string key(const std::string& name, const std::string& machine);
+
+    std::unordered_map<std::string, long long> ids_; // Keyed by key(name, machine)
+    long long next_id_ = 1; // Ids start at 1 in an empty ns table
+    std::vector<NewSensor> new_sensors_;
+};
@@ -0,0 +1,62 @@
+#include <stdexcept>
+
+#include "SensorRegistry.hpp"
+
+SensorRegistry::Table& SensorRegistry::getTable() {
+    static Table table;
+    return table;
+}
+
+SensorHandle SensorRegistry::intern(const std::string& label) {
+    Table& table = getTable();
+    {
+        std::shared_lock<std::shared_mutex> lock(table.mutex);
+        auto it = table.handles.find(label);
+        if (it != table.handles.end()) {
+            return it->second;
+        }
+    }
+
+    std::unique_lock<std::shared_mutex> lock(table.mutex);
+    auto it = table.handles.find(label); // Another thread may have interned it in the meantime
+    if (it != table.handles.end()) {
+        return it->second;
+    }
+    if (table.labels.size() >= static_cast<std::size_t>(INVALID_HANDLE)) {
+        throw std::runtime_error("Error in SensorRegistry::intern call: out of sensor handles");
+    }
+    const SensorHandle handle = static_cast<SensorHandle>(table.labels.size());
+    table.labels.push_back(label);
+    table.handles.emplace(label, handle);
+    return handle;
+}
+
+SensorHandle SensorRegistry::find(const std::string& label) {
+    Table& table = getTable();
+    std::shared_lock<std::shared_mutex> lock(table.mutex);
+    auto it = table.handles.find(label);
+    return it != table.handles.end() ? it->second : INVALID_HANDLE;
+}
+
+const std::string& SensorRegistry::getLabel(SensorHandle handle) {
+    static const std::string empty_label;
+    Table& table = getTable();
+    std::shared_lock<std::shared_mutex> lock(table.mutex);
+    const std::size_t index = static_cast<std::size_t>(handle);
+    return index < table.labels.size() ? table.labels[index] : empty_label;
+}
+
+std::vector<std::string> SensorRegistry::getLabels(const std::vector<SensorHandle>& handles) {
+    std::vector<std::string> labels;
+    labels.reserve(handles.size());
+    for (SensorHandle handle : handles) {
+        labels.push_back(getLabel(handle));
+    }
+    return labels;
+}
+
+std::size_t SensorRegistry::size() {
+    Table& table = getTable();
+    std::shared_lock<std::shared_mutex> lock(table.mutex);
+    return table.labels.size();
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include <mutex>
+#include <shared_mutex>
+#include <cstdint>
+#include <cstddef>
+
+// Compact identifier of a sensor, issued once per sensor label for the lifetime of the process.
+// Hot paths (data fetching, downsampling, rendering) key their state by handle instead of label,
+// so the label string is only looked up at the UI boundary
+enum class SensorHandle : std::uint32_t {};
+
+// Process-wide interning table mapping sensor labels to handles and back. Thread safe
+class SensorRegistry {
+public:
+    constexpr static SensorHandle INVALID_HANDLE = static_cast<SensorHandle>(UINT32_MAX);
+
+    static SensorHandle intern(const std::string& label); // Handle of the label, issuing a new one if needed
+    static SensorHandle find(const std::string& label); // INVALID_HANDLE if the label was never interned
+    static const std::string& getLabel(SensorHandle handle); // Stable reference. Empty for invalid handles
+    static std::vector<std::string> getLabels(const std::vector<SensorHandle>& handles);
+    static std::size_t size();
+
+private:
+    struct Table {
+        std::unordered_map<std::string, SensorHandle> handles;
+        std::deque<std::string> labels; // Indexed by handle. A deque never moves its elements
+        std::shared_mutex mutex;
+    };
+    static Table& getTable();
+};
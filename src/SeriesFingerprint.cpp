@@ -0,0 +1,173 @@
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+
+#include "SeriesFingerprint.hpp"
+
+SeriesFingerprint::SeriesFingerprint(double window_width) : window_width_(window_width) {
+    if (!(window_width > 0)) {
+        std::cerr << "Error in SeriesFingerprint constructor: window width must be positive\n";
+        throw std::runtime_error("Error in SeriesFingerprint constructor: window width must be positive");
+    }
+}
+
+void SeriesFingerprint::Window::addTime(double time) {
+    if (count == 0) {
+        min_time = max_time = time;
+    } else {
+        min_time = std::min(min_time, time);
+        max_time = std::max(max_time, time);
+    }
+    ++count;
+    hash += hashTime(time);
+}
+
+// splitmix64 finalizer of the bits of the time. Window hashes are sums of these, which makes them
+// independent of the order samples were added in
+std::uint64_t SeriesFingerprint::hashTime(double time) {
+    std::uint64_t x = std::bit_cast<std::uint64_t>(time + 0.0); // + 0.0 folds -0 into 0
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+std::int64_t SeriesFingerprint::getWindow(double time) const {
+    return static_cast<std::int64_t>(std::floor(time / window_width_));
+}
+
+double SeriesFingerprint::getWindowWidth() const {
+    return window_width_;
+}
+
+void SeriesFingerprint::add(std::string_view name, const Windows& windows) {
+    if (windows.empty()) {
+        return;
+    }
+    auto it = sensors_.find(name);
+    if (it == sensors_.end()) {
+        sensors_.emplace(std::string(name), windows);
+        return;
+    }
+
+    // Merge the two sorted window lists. Windows in both are combined when their samples are disjoint in
+    // time (e.g. a window split across import batches) and take the new summary otherwise
+    const Windows& stored = it->second;
+    Windows merged;
+    merged.reserve(stored.size() + windows.size());
+    auto a = stored.begin();
+    auto b = windows.begin();
+    while (a != stored.end() || b != windows.end()) {
+        if (b == windows.end() || (a != stored.end() && a->index < b->index)) {
+            merged.push_back(*a++);
+        } else if (a == stored.end() || b->index < a->index) {
+            merged.push_back(*b++);
+        } else {
+            Window window = *b;
+            if (a->max_time < b->min_time || b->max_time < a->min_time) {
+                window.count += a->count;
+                window.min_time = std::min(a->min_time, b->min_time);
+                window.max_time = std::max(a->max_time, b->max_time);
+                window.hash += a->hash;
+            }
+            merged.push_back(window);
+            ++a;
+            ++b;
+        }
+    }
+    it->second = std::move(merged);
+}
+
+const SeriesFingerprint::Windows* SeriesFingerprint::find(std::string_view name) const {
+    auto it = sensors_.find(name);
+    return it == sensors_.end() ? nullptr : &it->second;
+}
+
+std::size_t SeriesFingerprint::size() const {
+    return sensors_.size();
+}
+
+void SeriesFingerprint::clear() {
+    sensors_.clear();
+}
+
+bool SeriesFingerprint::load(const std::string& path) {
+    std::ifstream file(path);
+    if (!file) {
+        return false;
+    }
+
+    std::string line;
+    std::getline(file, line);
+    const std::string header = FILE_HEADER;
+    if (line.compare(0, header.size(), header) != 0) {
+        std::cerr << "SeriesFingerprint: " << path << " is not a series fingerprint of this version, ignoring it\n";
+        return false;
+    }
+    double window_width = 0;
+    std::istringstream(line.substr(header.size())) >> window_width;
+    if (std::fabs(window_width - window_width_) > 1e-9 * window_width_) {
+        std::cerr << "SeriesFingerprint: " << path << " uses another window width, ignoring it\n";
+        return false;
+    }
+
+    // One line per window: name, window index, count, min and max time, hash. Windows of a sensor are
+    // saved in order
+    std::string name;
+    Windows windows;
+    while (std::getline(file, line)) {
+        const std::size_t first_tab = line.find('\t');
+        const std::size_t second_tab = line.find('\t', first_tab + 1);
+        if (first_tab == std::string::npos || second_tab == std::string::npos) {
+            continue;
+        }
+        if (line.compare(0, first_tab, name) != 0) {
+            add(name, windows);
+            name = line.substr(0, first_tab);
+            windows.clear();
+        }
+        Window window{};
+        std::istringstream(line.substr(first_tab + 1)) >> window.index >> window.count >> window.min_time >>
+            window.max_time >> window.hash;
+        windows.push_back(window);
+    }
+    add(name, windows);
+    return true;
+}
+
+bool SeriesFingerprint::save(const std::string& path) const {
+    // Write a temporary file and rename it, so a crash never leaves a truncated fingerprint behind
+    const std::string temporary_path = path + ".tmp";
+    {
+        std::ofstream file(temporary_path, std::ios::trunc);
+        if (!file) {
+            std::cerr << "SeriesFingerprint: cannot write " << temporary_path << "\n";
+            return false;
+        }
+        file << FILE_HEADER << " " << std::setprecision(17) << window_width_ << "\n";
+        for (const auto& [name, windows] : sensors_) {
+            for (const Window& window : windows) {
+                file << name << '\t' << window.index << '\t' << window.count << '\t' << window.min_time << '\t' <<
+                    window.max_time << '\t' << window.hash << '\n';
+            }
+        }
+        if (!file) {
+            std::cerr << "SeriesFingerprint: error writing " << temporary_path << "\n";
+            return false;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temporary_path, path, error);
+    if (error) {
+        std::cerr << "SeriesFingerprint: cannot replace " << path << ": " << error.message() << "\n";
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <functional>
+#include <cstdint>
+#include <cstddef>
+
+// Compact record of what was already uploaded to a bucket: for every sensor, a summary of the samples
+// in each fixed-width time window it has data in (count, first and last time and a hash of the times).
+// A few dozen bytes per window instead of 16 per sample, so it can be kept (and saved) across imports
+// in place of the data itself. See fingerprintDifference
+class SeriesFingerprint {
+public:
+    struct Window {
+        std::int64_t index; // floor(time / window width)
+        std::uint32_t count = 0; // Samples known to be in the bucket
+        double min_time = 0; // Earliest and latest of those samples
+        double max_time = 0;
+        std::uint64_t hash = 0; // Sum of hashTime over their times, so disjoint sets of samples add up
+
+        void addTime(double time);
+        bool operator==(const Window& other) const = default;
+    };
+    using Windows = std::vector<Window>; // Sorted by index
+
+    static std::uint64_t hashTime(double time);
+
+    // Width in the time unit of the data it fingerprints (e.g. days for Epitrend, seconds for RGA)
+    explicit SeriesFingerprint(double window_width);
+
+    std::int64_t getWindow(double time) const;
+    double getWindowWidth() const;
+
+    // Record that the bucket holds the samples summarized by `windows`. A window already recorded is
+    // extended when the new samples lie wholly before or after the recorded ones, and replaced otherwise:
+    // the union of overlapping uploads is unknown, so it is left to be uploaded again
+    void add(std::string_view name, const Windows& windows);
+
+    const Windows* find(std::string_view name) const; // nullptr if nothing of the sensor was recorded
+    std::size_t size() const; // Sensors
+    void clear();
+
+    // load returns false (leaving the fingerprint unchanged) if the file is missing, not a fingerprint
+    // or uses another window width; save returns false on write errors
+    bool load(const std::string& path);
+    bool save(const std::string& path) const;
+
+private:
+    struct NameHash {
+        using is_transparent = void;
+        std::size_t operator()(std::string_view name) const { return std::hash<std::string_view>{}(name); }
+    };
+
+    constexpr static const char* FILE_HEADER = "SERIES_FINGERPRINT 2";
+
+    double window_width_;
+    std::unordered_map<std::string, Windows, NameHash, std::equal_to<>> sensors_;
+};
@@ -0,0 +1,133 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "SpectrogramCache.hpp"
+
+namespace {
+constexpr double EMPTY = std::numeric_limits<double>::quiet_NaN();
+
+std::int64_t floorDiv(std::int64_t a, std::int64_t b) {
+    return a / b - (a % b != 0 && (a < 0) != (b < 0));
+}
+
+std::int64_t getColumn(int level, double time) {
+    return static_cast<std::int64_t>(std::floor(time / SpectrogramCache::getColumnSeconds(level)));
+}
+}
+
+SpectrogramCache::SpectrogramCache(std::size_t rows, std::size_t max_tiles)
+    : rows_(rows), max_tiles_(std::max<std::size_t>(max_tiles, 1)) {}
+
+std::size_t SpectrogramCache::getRows() const { return rows_; }
+
+double SpectrogramCache::getColumnSeconds(int level) {
+    return BASE_COLUMN_SECONDS * std::pow(LEVEL_FACTOR, level);
+}
+
+int SpectrogramCache::chooseLevel(double start, double end, int pixel_width) {
+    const double pixel_seconds = (end - start) / std::max(pixel_width, 1);
+    if (!(pixel_seconds > BASE_COLUMN_SECONDS)) {
+        return 0;
+    }
+    const int level = static_cast<int>(std::ceil(std::log(pixel_seconds / BASE_COLUMN_SECONDS) / std::log(LEVEL_FACTOR)));
+    return std::clamp(level, 0, LEVEL_COUNT - 1);
+}
+
+SpectrogramCache::TileKey SpectrogramCache::getTileKey(int level, double time) {
+    return {level, floorDiv(getColumn(level, time), static_cast<std::int64_t>(TILE_COLUMNS))};
+}
+
+std::pair<double, double> SpectrogramCache::getTileRange(TileKey key) {
+    const double tile_seconds = getColumnSeconds(key.level) * TILE_COLUMNS;
+    return {static_cast<double>(key.index) * tile_seconds, static_cast<double>(key.index + 1) * tile_seconds};
+}
+
+std::vector<SpectrogramCache::TileKey> SpectrogramCache::getMissingTiles(int level, double start, double end) const {
+    std::vector<TileKey> missing;
+    if (!(start <= end)) {
+        return missing;
+    }
+
+    const TileKey first = getTileKey(level, start);
+    const TileKey last = getTileKey(level, end);
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (TileKey key = first; key.index <= last.index; ++key.index) {
+        auto it = tiles_.find(key);
+        if (it == tiles_.end() || !it->second.complete) {
+            missing.push_back(key);
+        }
+    }
+    return missing;
+}
+
+SpectrogramCache::Tile SpectrogramCache::makeTile(TileKey key) const {
+    return {key, std::vector<double>(rows_ * TILE_COLUMNS, EMPTY)};
+}
+
+void SpectrogramCache::addSample(Tile& tile, double time, std::size_t row, double value) const {
+    const std::int64_t column = getColumn(tile.key.level, time) - tile.key.index * static_cast<std::int64_t>(TILE_COLUMNS);
+    if (row >= rows_ || column < 0 || column >= static_cast<std::int64_t>(TILE_COLUMNS) || std::isnan(value)) {
+        return;
+    }
+    double& cell = tile.values[row * TILE_COLUMNS + static_cast<std::size_t>(column)];
+    cell = std::isnan(cell) ? value : std::max(cell, value);
+}
+
+void SpectrogramCache::storeTile(Tile tile) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    tiles_[tile.key] = Entry{std::move(tile.values), tile.complete, ++use_counter_};
+    ++version_;
+    evict();
+}
+
+SpectrogramCache::Image SpectrogramCache::getImage(int level, double start, double end) const {
+    Image image;
+    image.level = level;
+    image.rows = rows_;
+    if (!(start <= end)) {
+        return image;
+    }
+
+    const double column_seconds = getColumnSeconds(level);
+    const std::int64_t first_column = getColumn(level, start);
+    const std::int64_t last_column = getColumn(level, end);
+    image.columns = static_cast<std::size_t>(last_column - first_column + 1);
+    image.start = static_cast<double>(first_column) * column_seconds;
+    image.end = static_cast<double>(last_column + 1) * column_seconds;
+    image.values.assign(image.rows * image.columns, EMPTY);
+
+    // Copy the visible columns of each cached tile
+    const std::int64_t tile_columns = static_cast<std::int64_t>(TILE_COLUMNS);
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (std::int64_t index = floorDiv(first_column, tile_columns); index <= floorDiv(last_column, tile_columns); ++index) {
+        auto it = tiles_.find({level, index});
+        if (it == tiles_.end()) {
+            continue;
+        }
+        it->second.last_used = ++use_counter_;
+
+        const std::int64_t tile_first = index * tile_columns;
+        const std::int64_t from = std::max(first_column, tile_first);
+        const std::int64_t to = std::min(last_column, tile_first + tile_columns - 1);
+        for (std::size_t row = 0; row < rows_; ++row) {
+            const double* source = it->second.values.data() + row * TILE_COLUMNS;
+            std::copy(source + (from - tile_first), source + (to - tile_first + 1),
+                image.values.begin() + row * image.columns + (from - first_column));
+        }
+    }
+    return image;
+}
+
+std::uint64_t SpectrogramCache::getVersion() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return version_;
+}
+
+void SpectrogramCache::evict() {
+    while (tiles_.size() > max_tiles_) {
+        auto oldest = std::min_element(tiles_.begin(), tiles_.end(),
+            [](const auto& a, const auto& b) { return a.second.last_used < b.second.last_used; });
+        tiles_.erase(oldest);
+    }
+}
@@ -0,0 +1,84 @@
+#pragma once
+#include <vector>
+#include <map>
+#include <mutex>
+#include <compare>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+// Time x row (e.g. AMU) max-aggregation of many sensors, kept in tiles at several zoom levels. A column
+// of level L covers BASE_COLUMN_SECONDS * LEVEL_FACTOR^L seconds, and a tile holds TILE_COLUMNS
+// consecutive columns of every row. A view picks the finest level whose columns are at least a pixel
+// wide, so building an image costs the number of visible columns, not the number of samples. Tiles are
+// filled whole (e.g. from one aggregated query) and the least recently used ones are dropped past
+// max_tiles. Tiles reaching past the newest data are stored as incomplete: they are drawn, but still
+// reported missing so they are fetched again. Thread safe
+class SpectrogramCache {
+public:
+    constexpr static std::size_t TILE_COLUMNS = 64;
+    constexpr static double BASE_COLUMN_SECONDS = 1;
+    constexpr static double LEVEL_FACTOR = 4;
+    constexpr static int LEVEL_COUNT = 12; // Up to about 48 days per column
+    constexpr static std::size_t DEFAULT_MAX_TILES = 1024;
+
+    struct TileKey {
+        int level;
+        std::int64_t index; // Tile of the level, counted from the epoch
+        auto operator<=>(const TileKey&) const = default;
+    };
+
+    // Max of the samples in every cell, row-major (rows x TILE_COLUMNS). NaN where there is no sample
+    struct Tile {
+        TileKey key;
+        std::vector<double> values;
+        bool complete = true; // False if more samples may still arrive for the tile
+    };
+
+    // Cells of [start, end) at one level, row-major (rows x columns). NaN where there is no sample or the
+    // tile is not in the cache
+    struct Image {
+        int level = 0;
+        std::size_t rows = 0;
+        std::size_t columns = 0;
+        double start = 0; // Seconds, start of the first column
+        double end = 0; // Seconds, end of the last column
+        std::vector<double> values;
+    };
+
+    explicit SpectrogramCache(std::size_t rows, std::size_t max_tiles = DEFAULT_MAX_TILES);
+
+    std::size_t getRows() const;
+    static double getColumnSeconds(int level);
+    static int chooseLevel(double start, double end, int pixel_width);
+    static TileKey getTileKey(int level, double time);
+    static std::pair<double, double> getTileRange(TileKey key); // Seconds, [start, end)
+
+    // Tiles of the level over [start, end] that are not in the cache or are incomplete, in time order
+    std::vector<TileKey> getMissingTiles(int level, double start, double end) const;
+
+    // Fill a tile, then store it. Samples outside the tile (or row) are ignored
+    Tile makeTile(TileKey key) const;
+    void addSample(Tile& tile, double time, std::size_t row, double value) const;
+    void storeTile(Tile tile);
+
+    Image getImage(int level, double start, double end) const;
+    std::uint64_t getVersion() const; // Increases on every storeTile
+
+private:
+    struct Entry {
+        std::vector<double> values;
+        bool complete;
+        std::uint64_t last_used;
+    };
+
+    void evict(); // Must be called with mutex_ held
+
+    const std::size_t rows_;
+    const std::size_t max_tiles_;
+
+    mutable std::mutex mutex_;
+    mutable std::map<TileKey, Entry> tiles_; // Guarded by mutex_
+    mutable std::uint64_t use_counter_ = 0; // Guarded by mutex_
+    std::uint64_t version_ = 0; // Guarded by mutex_
+};
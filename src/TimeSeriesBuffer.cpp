@@ -1,15 +1,142 @@
 #include "TimeSeriesBuffer.hpp"
-#include <iostream>
 #include <algorithm>
 #include <cmath>
+#include <tuple>
 
+// ==================================================
+// TimeSeriesRangeView
+// ==================================================
 template<typename Timestamp, typename Value>
-TimeSeriesBuffer<Timestamp, Value>::TimeSeriesBuffer(double preload_factor)
-    : preload_factor_(preload_factor), stop_background_thread_(false) {}
+TimeSeriesRangeView<Timestamp, Value>::TimeSeriesRangeView(std::vector<Segment> segments)
+    : segments_(std::move(segments)) {
+    // Drop empty segments so iteration never lands on one
+    segments_.erase(std::remove_if(segments_.begin(), segments_.end(),
+        [](const Segment& segment) { return !segment.chunk || segment.begin >= segment.end; }),
+        segments_.end());
+}
+
+template<typename Timestamp, typename Value>
+std::size_t TimeSeriesRangeView<Timestamp, Value>::size() const {
+    std::size_t total = 0;
+    for (const auto& segment : segments_) {
+        total += segment.end - segment.begin;
+    }
+    return total;
+}
+
+template<typename Timestamp, typename Value>
+bool TimeSeriesRangeView<Timestamp, Value>::empty() const {
+    return segments_.empty();
+}
+
+template<typename Timestamp, typename Value>
+typename TimeSeriesRangeView<Timestamp, Value>::const_iterator TimeSeriesRangeView<Timestamp, Value>::begin() const {
+    if (segments_.empty()) {
+        return end();
+    }
+    return const_iterator(&segments_, 0, segments_.front().begin);
+}
+
+template<typename Timestamp, typename Value>
+typename TimeSeriesRangeView<Timestamp, Value>::const_iterator TimeSeriesRangeView<Timestamp, Value>::end() const {
+    return const_iterator(&segments_, segments_.size(), 0);
+}
+
+template<typename Timestamp, typename Value>
+TimeSeriesRangeView<Timestamp, Value> TimeSeriesRangeView<Timestamp, Value>::slice(
+    Timestamp start, Timestamp end, bool include_neighbours) const {
+    // Positions are (segment index, index within chunk). (segments_.size(), 0) is one past the end
+    using Position = std::pair<std::size_t, std::size_t>;
+    const Position end_position = {segments_.size(), 0};
+
+    // First sample with timestamp >= start
+    Position lower = end_position;
+    for (std::size_t i = 0; i < segments_.size(); ++i) {
+        const Segment& segment = segments_[i];
+        const auto& timestamps = segment.chunk->timestamps;
+        if (timestamps[segment.end - 1] < start) {
+            continue;
+        }
+        auto it = std::lower_bound(timestamps.begin() + segment.begin, timestamps.begin() + segment.end, start);
+        lower = {i, static_cast<std::size_t>(it - timestamps.begin())};
+        break;
+    }
+
+    // First sample with timestamp > end
+    Position upper = end_position;
+    for (std::size_t i = lower.first; i < segments_.size(); ++i) {
+        const Segment& segment = segments_[i];
+        const auto& timestamps = segment.chunk->timestamps;
+        if (!(end < timestamps[segment.end - 1])) {
+            continue;
+        }
+        auto it = std::upper_bound(timestamps.begin() + segment.begin, timestamps.begin() + segment.end, end);
+        upper = {i, static_cast<std::size_t>(it - timestamps.begin())};
+        break;
+    }
+
+    // Extend by one sample on each side
+    if (include_neighbours) {
+        if (lower.first < segments_.size() && lower.second > segments_[lower.first].begin) {
+            --lower.second;
+        } else if (lower.first > 0) {
+            lower = {lower.first - 1, segments_[lower.first - 1].end - 1};
+        }
+        if (upper.first < segments_.size()) {
+            if (++upper.second >= segments_[upper.first].end) {
+                upper = {upper.first + 1, upper.first + 1 < segments_.size() ? segments_[upper.first + 1].begin : 0};
+            }
+        }
+    }
+
+    // Collect the segments between lower and upper
+    std::vector<Segment> sliced;
+    for (std::size_t i = lower.first; i < segments_.size() && i <= upper.first; ++i) {
+        Segment segment = segments_[i];
+        if (i == lower.first) {
+            segment.begin = lower.second;
+        }
+        if (i == upper.first) {
+            segment.end = upper.second;
+        }
+        sliced.push_back(std::move(segment));
+    }
+    return TimeSeriesRangeView(std::move(sliced));
+}
+
+template<typename Timestamp, typename Value>
+std::vector<std::pair<Timestamp, Value>> TimeSeriesRangeView<Timestamp, Value>::toVector() const {
+    std::vector<std::pair<Timestamp, Value>> result;
+    result.reserve(size());
+    for (const auto& segment : segments_) {
+        for (std::size_t i = segment.begin; i < segment.end; ++i) {
+            result.emplace_back(segment.chunk->timestamps[i], segment.chunk->values[i]);
+        }
+    }
+    return result;
+}
+
+
+
+
+// ==================================================
+// TimeSeriesBuffer
+// ==================================================
+template<typename Timestamp, typename Value>
+TimeSeriesBuffer<Timestamp, Value>::TimeSeriesBuffer(double preload_factor, std::pmr::memory_resource* resource)
+    : resource_(resource), preload_factor_(preload_factor), stop_background_thread_(false) {}
 
 template<typename Timestamp, typename Value>
 TimeSeriesBuffer<Timestamp, Value>::~TimeSeriesBuffer() {
-    stop_background_thread_ = true;
+    stopPreload();
+}
+
+template<typename Timestamp, typename Value>
+void TimeSeriesBuffer<Timestamp, Value>::stopPreload() {
+    {
+        std::lock_guard<std::mutex> lock(preload_mutex_);
+        stop_background_thread_ = true;
+    }
     preload_condition_.notify_one();
 
     if (background_thread_.joinable()) {
@@ -20,12 +147,17 @@ TimeSeriesBuffer<Timestamp, Value>::~TimeSeriesBuffer() {
 // Move constructor
 template<typename Timestamp, typename Value>
 TimeSeriesBuffer<Timestamp, Value>::TimeSeriesBuffer(TimeSeriesBuffer&& other) noexcept
-    : data_(std::move(other.data_)),
+    : resource_(other.resource_),
+      snapshot_(other.snapshot_.load()),
+      chunk_capacity_(other.chunk_capacity_),
       current_start_(std::move(other.current_start_)),
       current_end_(std::move(other.current_end_)),
+      preload_start_(other.preload_start_),
+      preload_end_(other.preload_end_),
       preload_factor_(other.preload_factor_),
+      version_(other.version_.load()),
       preload_callback_(std::move(other.preload_callback_)),
-      stop_background_thread_(other.stop_background_thread_) {
+      stop_background_thread_(other.stop_background_thread_.load()) {
     // Move the background thread if it is joinable
     if (other.background_thread_.joinable()) {
         background_thread_ = std::move(other.background_thread_);
@@ -37,18 +169,24 @@ TimeSeriesBuffer<Timestamp, Value>::TimeSeriesBuffer(TimeSeriesBuffer&& other) n
 template<typename Timestamp, typename Value>
 TimeSeriesBuffer<Timestamp, Value>& TimeSeriesBuffer<Timestamp, Value>::operator=(TimeSeriesBuffer&& other) noexcept {
     if (this != &other) {
-        stop_background_thread_ = true;
-        if (background_thread_.joinable()) {
-            background_thread_.join();
-        }
+        stopPreload();
 
-        data_ = std::move(other.data_);
+        resource_ = other.resource_;
+        snapshot_.store(other.snapshot_.load());
+        chunk_capacity_ = other.chunk_capacity_;
         current_start_ = other.current_start_;
         current_end_ = other.current_end_;
+        preload_start_ = other.preload_start_;
+        preload_end_ = other.preload_end_;
         preload_factor_ = other.preload_factor_;
+        {
+            std::lock_guard<std::mutex> cache_lock(decoded_cache_mutex_);
+            decoded_cache_.clear();
+        }
+        version_ = other.version_.load() + 1;
         preload_callback_ = std::move(other.preload_callback_);
         background_thread_ = std::move(other.background_thread_);
-        stop_background_thread_ = other.stop_background_thread_;
+        stop_background_thread_ = other.stop_background_thread_.load();
         other.stop_background_thread_ = true;
     }
     return *this;
@@ -56,97 +194,433 @@ TimeSeriesBuffer<Timestamp, Value>& TimeSeriesBuffer<Timestamp, Value>::operator
 
 template<typename Timestamp, typename Value>
 void TimeSeriesBuffer<Timestamp, Value>::initialize(const std::map<Timestamp, Value>& initial_data) {
-    std::lock_guard<std::mutex> lock(data_mutex_);
-    data_ = initial_data;
+    std::vector<Timestamp> timestamps;
+    std::vector<Value> values;
+    timestamps.reserve(initial_data.size());
+    values.reserve(initial_data.size());
+    for (const auto& [timestamp, value] : initial_data) {
+        timestamps.push_back(timestamp);
+        values.push_back(value);
+    }
+
+    auto chunk_set = std::make_shared<ChunkSet>();
+    chunk_set->chunks = makeChunks(timestamps, values);
+    chunk_set->size = initial_data.size();
+
+    std::lock_guard<std::mutex> lock(write_mutex_);
+    publish(std::move(chunk_set));
 }
 
 template<typename Timestamp, typename Value>
 void TimeSeriesBuffer<Timestamp, Value>::setRange(Timestamp start, Timestamp end, const std::function<void(Timestamp, Timestamp)>& preload_callback) {
-    std::lock_guard<std::mutex> lock(data_mutex_);
+    const Timestamp margin = static_cast<Timestamp>(static_cast<double>(end - start) * preload_factor_);
+    setRange(start, end, start - margin, end + margin, preload_callback);
+}
+
+template<typename Timestamp, typename Value>
+void TimeSeriesBuffer<Timestamp, Value>::setRange(Timestamp start, Timestamp end, Timestamp preload_start, Timestamp preload_end,
+    const std::function<void(Timestamp, Timestamp)>& preload_callback) {
+    std::unique_lock<std::mutex> lock(write_mutex_);
+    const bool range_changed = start != current_start_ || end != current_end_ ||
+        preload_start != preload_start_ || preload_end != preload_end_;
     current_start_ = start;
     current_end_ = end;
+    preload_start_ = std::min(preload_start, start);
+    preload_end_ = std::max(preload_end, end);
 
     preload_callback_ = preload_callback;
 
     if (!background_thread_.joinable()) {
         background_thread_ = std::thread([this]() {
-            while (!stop_background_thread_) {
+            while (true) {
+                // Wait for a request. Requests made while a preload runs are kept, not lost
                 {
-                    std::unique_lock<std::mutex> lock(preload_mutex_);
-                    preload_condition_.wait(lock);
+                    std::unique_lock<std::mutex> preload_lock(preload_mutex_);
+                    preload_condition_.wait(preload_lock, [this]() { return preload_requested_ || stop_background_thread_; });
+                    if (stop_background_thread_) {
+                        break;
+                    }
+                    preload_requested_ = false;
                 }
 
-                Timestamp preload_start = current_start_ - (current_end_ - current_start_) * preload_factor_;
-                Timestamp preload_end = current_end_ + (current_end_ - current_start_) * preload_factor_;
+                // Copy the range and callback so the (slow) preload runs without holding the write mutex
+                Timestamp range_start, range_end;
+                std::function<void(Timestamp, Timestamp)> callback;
+                {
+                    std::lock_guard<std::mutex> write_lock(write_mutex_);
+                    std::tie(range_start, range_end) = retentionRange();
+                    callback = preload_callback_;
+                }
 
-                preload_callback_(preload_start, preload_end);
+                callback(range_start, range_end);
             }
         });
     }
+    lock.unlock();
+
+    // Decompress the chunks the range moved back to, compress the ones it left
+    if (range_changed) {
+        cleanup();
+    }
+
+    // Request a preload of the new range
+    {
+        std::lock_guard<std::mutex> preload_lock(preload_mutex_);
+        preload_requested_ = true;
+    }
     preload_condition_.notify_one();
 }
 
+// Sorted batches that start after the last stored sample (the real-time case) take the append path.
+// It skips the merge and only runs the compression and size limit passes once per filled chunk, but
+// still copies the chunk pointer vector and the partly filled tail chunk (at most chunk_capacity_
+// samples): O(batch + chunks + chunk_capacity_) per batch. Anything else is merged into the chunks it overlaps
 template<typename Timestamp, typename Value>
 void TimeSeriesBuffer<Timestamp, Value>::addData(const std::vector<std::pair<Timestamp, Value>>& new_data) {
-    // Lock the data mutex and copy the temporary buffer into the main buffer
-    {
-        std::lock_guard<std::mutex> lock(data_mutex_);
-        data_.insert(new_data.begin(), new_data.end());
+    if (new_data.empty()) {
+        return;
     }
-    cleanup();
-    enforceSizeLimit();
+
+    // Sort the batch and drop duplicate timestamps (the first occurrence wins, as with std::map::insert).
+    // Skipped when the batch is already strictly increasing
+    std::vector<std::pair<Timestamp, Value>> sorted_data;
+    const std::vector<std::pair<Timestamp, Value>>* batch = &new_data;
+    if (std::adjacent_find(new_data.begin(), new_data.end(),
+            [](const auto& a, const auto& b) { return !(a.first < b.first); }) != new_data.end()) {
+        sorted_data = new_data;
+        std::stable_sort(sorted_data.begin(), sorted_data.end(),
+            [](const auto& a, const auto& b) { return a.first < b.first; });
+        sorted_data.erase(std::unique(sorted_data.begin(), sorted_data.end(),
+            [](const auto& a, const auto& b) { return a.first == b.first; }), sorted_data.end());
+        batch = &sorted_data;
+    }
+
+    std::lock_guard<std::mutex> lock(write_mutex_);
+    auto chunk_set = std::make_shared<ChunkSet>(*snapshot_.load());
+
+    bool maintain = true;
+    if (chunk_set->chunks.empty() || chunk_set->chunks.back()->back() < batch->front().first) {
+        maintain = appendData(*chunk_set, *batch);
+    } else {
+        mergeData(*chunk_set, *batch);
+    }
+
+    if (maintain) {
+        updateCompression(*chunk_set);
+        enforceSizeLimit(*chunk_set);
+    }
+    publish(std::move(chunk_set));
 }
 
+// Append a sorted batch that starts after the last stored sample. The tail chunk is topped up to
+// chunk_capacity_ and the rest goes to new chunks. Returns true when a chunk was filled up
 template<typename Timestamp, typename Value>
-std::vector<std::pair<Timestamp, Value>> TimeSeriesBuffer<Timestamp, Value>::getData() {
-    std::lock_guard<std::mutex> lock(data_mutex_);
+bool TimeSeriesBuffer<Timestamp, Value>::appendData(
+    ChunkSet& chunk_set, const std::vector<std::pair<Timestamp, Value>>& batch) const {
+    auto& chunks = chunk_set.chunks;
+    bool filled = false;
+    std::size_t offset = 0;
+
+    // Top up the tail chunk. Chunks are immutable, so it is replaced by an extended copy
+    if (!chunks.empty() && chunks.back()->size() < chunk_capacity_) {
+        ChunkPtr tail = hotChunk(chunks.back());
+        offset = std::min(batch.size(), chunk_capacity_ - tail->size());
+        auto extended = newChunk();
+        extended->timestamps.reserve(tail->size() + offset);
+        extended->values.reserve(tail->size() + offset);
+        extended->timestamps.assign(tail->timestamps.begin(), tail->timestamps.end());
+        extended->values.assign(tail->values.begin(), tail->values.end());
+        for (std::size_t i = 0; i < offset; ++i) {
+            extended->timestamps.push_back(batch[i].first);
+            extended->values.push_back(batch[i].second);
+        }
+        filled = extended->size() == chunk_capacity_;
+        chunks.back() = std::move(extended);
+    }
+
+    // Start new chunks for the rest
+    for (; offset < batch.size(); offset += chunk_capacity_) {
+        const std::size_t end = std::min(offset + chunk_capacity_, batch.size());
+        auto chunk = newChunk();
+        chunk->timestamps.reserve(end - offset);
+        chunk->values.reserve(end - offset);
+        for (std::size_t i = offset; i < end; ++i) {
+            chunk->timestamps.push_back(batch[i].first);
+            chunk->values.push_back(batch[i].second);
+        }
+        filled = filled || chunk->size() == chunk_capacity_;
+        chunks.push_back(std::move(chunk));
+    }
+
+    chunk_set.size += batch.size();
+    return filled;
+}
+
+// Merge a sorted batch into the chunks it overlaps. Existing samples win on equal timestamps
+template<typename Timestamp, typename Value>
+void TimeSeriesBuffer<Timestamp, Value>::mergeData(
+    ChunkSet& chunk_set, const std::vector<std::pair<Timestamp, Value>>& batch) const {
+    auto& chunks = chunk_set.chunks;
+
+    // Chunks [lo, hi) overlap the time span of the batch
+    auto lo_it = std::partition_point(chunks.begin(), chunks.end(),
+        [&](const ChunkPtr& chunk) { return chunk->back() < batch.front().first; });
+    auto hi_it = std::partition_point(lo_it, chunks.end(),
+        [&](const ChunkPtr& chunk) { return !(batch.back().first < chunk->front()); });
+    std::size_t lo = lo_it - chunks.begin();
+    std::size_t hi = hi_it - chunks.begin();
+
+    // Coalesce with small neighbouring chunks to keep the chunk count low
+    if (lo > 0 && chunks[lo - 1]->size() < chunk_capacity_ / 2) {
+        --lo;
+    }
+    if (hi < chunks.size() && chunks[hi]->size() < chunk_capacity_ / 2) {
+        ++hi;
+    }
+
+    // Merge the existing samples with the batch. Existing samples win on equal timestamps
+    std::vector<Timestamp> timestamps;
+    std::vector<Value> values;
+    std::size_t existing = 0;
+    for (std::size_t i = lo; i < hi; ++i) {
+        existing += chunks[i]->size();
+    }
+    timestamps.reserve(existing + batch.size());
+    values.reserve(existing + batch.size());
+
+    auto batch_it = batch.begin();
+    for (std::size_t i = lo; i < hi; ++i) {
+        ChunkPtr hot = hotChunk(chunks[i]);
+        const Chunk& chunk = *hot;
+        for (std::size_t j = 0; j < chunk.size(); ++j) {
+            while (batch_it != batch.end() && batch_it->first < chunk.timestamps[j]) {
+                timestamps.push_back(batch_it->first);
+                values.push_back(batch_it->second);
+                ++batch_it;
+            }
+            if (batch_it != batch.end() && batch_it->first == chunk.timestamps[j]) {
+                ++batch_it;
+            }
+            timestamps.push_back(chunk.timestamps[j]);
+            values.push_back(chunk.values[j]);
+        }
+    }
+    for (; batch_it != batch.end(); ++batch_it) {
+        timestamps.push_back(batch_it->first);
+        values.push_back(batch_it->second);
+    }
+
+    // Replace the overlapped chunks with the merged ones
+    std::vector<ChunkPtr> merged = makeChunks(timestamps, values);
+    chunks.erase(chunks.begin() + lo, chunks.begin() + hi);
+    chunks.insert(chunks.begin() + lo, merged.begin(), merged.end());
+    chunk_set.size = chunk_set.size - existing + timestamps.size();
+}
+
+template<typename Timestamp, typename Value>
+std::vector<std::pair<Timestamp, Value>> TimeSeriesBuffer<Timestamp, Value>::getData() const {
+    ChunkSetPtr chunk_set = snapshot_.load();
     std::vector<std::pair<Timestamp, Value>> result;
-    for (const auto& entry : data_) {
-        result.emplace_back(entry.first, entry.second);
+    result.reserve(chunk_set->size);
+    for (const auto& stored : chunk_set->chunks) {
+        ChunkPtr chunk = hotChunk(stored);
+        for (std::size_t i = 0; i < chunk->size(); ++i) {
+            result.emplace_back(chunk->timestamps[i], chunk->values[i]);
+        }
     }
     return result;
 }
 
 template<typename Timestamp, typename Value>
 std::map<Timestamp,Value> TimeSeriesBuffer<Timestamp, Value>::getDataMap() const {
-    return data_;
+    ChunkSetPtr chunk_set = snapshot_.load();
+    std::map<Timestamp, Value> result;
+    for (const auto& stored : chunk_set->chunks) {
+        ChunkPtr chunk = hotChunk(stored);
+        for (std::size_t i = 0; i < chunk->size(); ++i) {
+            result.emplace_hint(result.end(), chunk->timestamps[i], chunk->values[i]);
+        }
+    }
+    return result;
 }
 
+// Only the chunk pointers overlapping [start, end] are copied: O(log(chunks) + chunks in range)
+// regardless of how many samples the buffer holds. Cold chunks in the range are decompressed for the view,
+// or taken from the decoded chunk cache if an earlier view already decoded them
 template<typename Timestamp, typename Value>
-void TimeSeriesBuffer<Timestamp, Value>::cleanup() {
-    std::lock_guard<std::mutex> lock(data_mutex_);
-    Timestamp retention_start = current_start_ - (current_end_ - current_start_) * preload_factor_;
-    auto it = data_.lower_bound(retention_start);
+typename TimeSeriesBuffer<Timestamp, Value>::RangeView TimeSeriesBuffer<Timestamp, Value>::getRange(Timestamp start, Timestamp end) const {
+    std::vector<typename RangeView::Segment> segments;
+
+    ChunkSetPtr chunk_set = snapshot_.load();
+    const auto& chunks = chunk_set->chunks;
+    auto it = std::partition_point(chunks.begin(), chunks.end(),
+        [&](const ChunkPtr& chunk) { return chunk->back() < start; });
+    for (; it != chunks.end() && !(end < (*it)->front()); ++it) {
+        ChunkPtr chunk = cachedHotChunk(*it);
+        const auto& timestamps = chunk->timestamps;
+        std::size_t begin_index = 0;
+        std::size_t end_index = timestamps.size();
+        if (chunk->front() < start) {
+            begin_index = std::lower_bound(timestamps.begin(), timestamps.end(), start) - timestamps.begin();
+        }
+        if (end < chunk->back()) {
+            end_index = std::upper_bound(timestamps.begin(), timestamps.end(), end) - timestamps.begin();
+        }
+        segments.push_back({std::move(chunk), begin_index, end_index});
+    }
+    return RangeView(std::move(segments));
+}
+
+template<typename Timestamp, typename Value>
+std::size_t TimeSeriesBuffer<Timestamp, Value>::size() const {
+    return snapshot_.load()->size;
+}
 
-    Timestamp retention_end = current_end_ + (current_end_ - current_start_) * preload_factor_;
+template<typename Timestamp, typename Value>
+std::uint64_t TimeSeriesBuffer<Timestamp, Value>::getVersion() const {
+    return version_.load();
+}
+
+template<typename Timestamp, typename Value>
+std::size_t TimeSeriesBuffer<Timestamp, Value>::getByteSize() const {
+    ChunkSetPtr chunk_set = snapshot_.load();
+    std::size_t bytes = chunk_set->chunks.capacity() * sizeof(ChunkPtr);
+    for (const auto& chunk : chunk_set->chunks) {
+        bytes += chunkByteSize(*chunk);
+    }
+    return bytes;
+}
 
-    // Remove all entries before retention_start
-    data_.erase(data_.begin(), it);
+template<typename Timestamp, typename Value>
+std::size_t TimeSeriesBuffer<Timestamp, Value>::evict(std::size_t bytes_to_free, bool keep_retention_range) {
+    std::lock_guard<std::mutex> lock(write_mutex_);
+    {
+        // Decoded copies would keep evicted chunks alive
+        std::lock_guard<std::mutex> cache_lock(decoded_cache_mutex_);
+        decoded_cache_.clear();
+    }
+    auto chunk_set = std::make_shared<ChunkSet>(*snapshot_.load());
+    auto& chunks = chunk_set->chunks;
+    const auto [keep_start, keep_end] = keep_retention_range ? retentionRange() : std::make_pair(current_start_, current_end_);
 
-    // Remove all entries after retention_end
-    it = data_.upper_bound(retention_end);
+    // Chunks are sorted, so the ones farthest from the current range are always at either end
+    std::size_t freed = 0;
+    std::size_t first = 0;
+    std::size_t last = chunks.size();
+    while (freed < bytes_to_free && first < last) {
+        const Chunk& front = *chunks[first];
+        const Chunk& back = *chunks[last - 1];
+        const bool front_outside = front.back() < keep_start;
+        const bool back_outside = keep_end < back.front();
 
-    // Check if the iterator is valid
-    if (it != data_.end()) {
-        data_.erase(it, data_.end());
+        bool take_front;
+        if (front_outside && back_outside) {
+            take_front = (current_start_ - front.back()) >= (back.front() - current_end_);
+        } else if (front_outside || back_outside) {
+            take_front = front_outside;
+        } else if (!keep_retention_range) {
+            take_front = true;
+        } else {
+            break; // Only chunks overlapping the retention range are left
+        }
+
+        const Chunk& victim = take_front ? front : back;
+        freed += chunkByteSize(victim);
+        chunk_set->size -= victim.size();
+        if (take_front) {
+            ++first;
+        } else {
+            --last;
+        }
     }
+
+    if (first == 0 && last == chunks.size()) {
+        return 0;
+    }
+    chunks.erase(chunks.begin() + last, chunks.end());
+    chunks.erase(chunks.begin(), chunks.begin() + first);
+    chunks.shrink_to_fit();
+    publish(std::move(chunk_set));
+    return freed;
+}
+
+// Current range plus the preload margins set with it. Must be called with write_mutex_ held
+template<typename Timestamp, typename Value>
+std::pair<Timestamp, Timestamp> TimeSeriesBuffer<Timestamp, Value>::retentionRange() const {
+    return {preload_start_, preload_end_};
 }
 
+// Publish a new chunk set to the readers. Must be called with write_mutex_ held
 template<typename Timestamp, typename Value>
-void TimeSeriesBuffer<Timestamp, Value>::enforceSizeLimit() {
+void TimeSeriesBuffer<Timestamp, Value>::publish(std::shared_ptr<ChunkSet> chunk_set) {
+    snapshot_.store(std::move(chunk_set));
+    ++version_;
+}
+
+// Compress the chunks the range has left and decompress the ones it moved back to
+template<typename Timestamp, typename Value>
+void TimeSeriesBuffer<Timestamp, Value>::cleanup() {
+    std::lock_guard<std::mutex> lock(write_mutex_);
+    auto chunk_set = std::make_shared<ChunkSet>(*snapshot_.load());
+    if (updateCompression(*chunk_set)) {
+        publish(std::move(chunk_set));
+    }
+}
+
+// Compress the chunks outside the retention range and decompress the ones inside it. Cold data is
+// kept at full resolution until the DataManager memory governor evicts it. Returns true if any chunk changed.
+// Must be called with write_mutex_ held
+template<typename Timestamp, typename Value>
+bool TimeSeriesBuffer<Timestamp, Value>::updateCompression(ChunkSet& chunk_set) const {
+    const auto [retention_start, retention_end] = retentionRange();
+
+    bool changed = false;
+    for (auto& chunk : chunk_set.chunks) {
+        const bool retained = !(chunk->back() < retention_start) && !(retention_end < chunk->front());
+        if (retained == !chunk->isCompressed()) {
+            continue;
+        }
+        chunk = retained ? decompressChunk(chunk) : compressChunk(chunk);
+        changed = true;
+    }
+    return changed;
+}
+
+// Downsample the uncompressed (retained) samples when they exceed max_data_points_. Compressed chunks
+// are left at full resolution. Must be called with write_mutex_ held
+template<typename Timestamp, typename Value>
+void TimeSeriesBuffer<Timestamp, Value>::enforceSizeLimit(ChunkSet& chunk_set) const {
+    auto& chunks = chunk_set.chunks;
+
+    // Count the uncompressed samples. After updateCompression() they form one run of chunks [first_hot, last_hot)
+    std::size_t hot_size = 0;
+    std::size_t first_hot = chunks.size();
+    std::size_t last_hot = 0;
+    for (std::size_t i = 0; i < chunks.size(); ++i) {
+        if (!chunks[i]->isCompressed()) {
+            hot_size += chunks[i]->size();
+            first_hot = std::min(first_hot, i);
+            last_hot = i + 1;
+        }
+    }
+
     // Check if the data size exceeds the maximum limit
-    if (data_.size() <= max_data_points_) {
+    if (hot_size <= static_cast<std::size_t>(max_data_points_)) {
         return;
     }
 
-    // DEBUG
-    std::cout << "-----------------------------Enforcing size limit-----------------------------\n";
-
-    // Convert the map to a vector of TimeSeriesPoint
+    // Convert the run to a vector of TimeSeriesPoint. Timestamps are taken relative to the first one
+    // so integer timestamps survive the round trip through double
     std::vector<TimeSeriesPoint> points;
-    points.reserve(data_.size());
-    for (const auto& entry : data_) {
-        points.push_back({static_cast<double>(entry.first), static_cast<double>(entry.second)});
+    std::size_t run_size = 0;
+    const Timestamp base = chunks[first_hot]->front();
+    points.reserve(hot_size);
+    for (std::size_t i = first_hot; i < last_hot; ++i) {
+        ChunkPtr chunk = hotChunk(chunks[i]);
+        run_size += chunk->size();
+        for (std::size_t j = 0; j < chunk->size(); ++j) {
+            points.push_back({static_cast<double>(chunk->timestamps[j] - base), static_cast<double>(chunk->values[j])});
+        }
     }
 
     // Prepare a vector to hold the downsampled data
@@ -157,15 +631,115 @@ void TimeSeriesBuffer<Timestamp, Value>::enforceSizeLimit() {
     LargestTriangleThreeBuckets<TimeSeriesPoint, double, &TimeSeriesPoint::timestamp, &TimeSeriesPoint::value>::Downsample(
         points.begin(), points.size(), std::back_inserter(downsampled_points), max_data_points_);
 
-    // Convert the downsampled vector back to a map
-    std::map<Timestamp, Value> downsampled_data;
+    // Convert the downsampled vector back to chunks
+    std::vector<Timestamp> timestamps;
+    std::vector<Value> values;
+    timestamps.reserve(downsampled_points.size());
+    values.reserve(downsampled_points.size());
     for (const auto& point : downsampled_points) {
-        downsampled_data[static_cast<Timestamp>(point.timestamp)] = static_cast<Value>(point.value);
+        timestamps.push_back(base + static_cast<Timestamp>(point.timestamp));
+        values.push_back(static_cast<Value>(point.value));
     }
 
-    // Lock the data mutex and replace the data with the downsampled data
-    std::lock_guard<std::mutex> lock(data_mutex_);
-    data_ = std::move(downsampled_data);
+    // Replace the run with the downsampled data
+    std::vector<ChunkPtr> downsampled = makeChunks(timestamps, values);
+    chunks.erase(chunks.begin() + first_hot, chunks.begin() + last_hot);
+    chunks.insert(chunks.begin() + first_hot, downsampled.begin(), downsampled.end());
+    chunk_set.size = chunk_set.size - run_size + timestamps.size();
+}
+
+// Sample storage plus the chunk object and its shared_ptr control block
+template<typename Timestamp, typename Value>
+std::size_t TimeSeriesBuffer<Timestamp, Value>::chunkByteSize(const Chunk& chunk) {
+    return sizeof(Chunk) + 2 * sizeof(void*) + chunk.compressed.capacity() * sizeof(std::uint64_t) +
+        chunk.timestamps.capacity() * sizeof(Timestamp) + chunk.values.capacity() * sizeof(Value);
+}
+
+template<typename Timestamp, typename Value>
+std::shared_ptr<typename TimeSeriesBuffer<Timestamp, Value>::Chunk> TimeSeriesBuffer<Timestamp, Value>::newChunk() const {
+    return std::allocate_shared<Chunk>(std::pmr::polymorphic_allocator<Chunk>(resource_), resource_);
+}
+
+template<typename Timestamp, typename Value>
+typename TimeSeriesBuffer<Timestamp, Value>::ChunkPtr TimeSeriesBuffer<Timestamp, Value>::compressChunk(const ChunkPtr& chunk) const {
+    if (chunk->isCompressed() || chunk->empty()) {
+        return chunk;
+    }
+    auto compressed = newChunk();
+    GorillaCodec<Timestamp, Value>::Encode(
+        chunk->timestamps.data(), chunk->values.data(), chunk->size(), compressed->compressed);
+    compressed->compressed_size = chunk->size();
+    compressed->compressed_front = chunk->front();
+    compressed->compressed_back = chunk->back();
+    return compressed;
+}
+
+template<typename Timestamp, typename Value>
+typename TimeSeriesBuffer<Timestamp, Value>::ChunkPtr TimeSeriesBuffer<Timestamp, Value>::decompressChunk(const ChunkPtr& chunk) const {
+    if (!chunk->isCompressed()) {
+        return chunk;
+    }
+    auto decompressed = newChunk();
+    decompressed->timestamps.resize(chunk->compressed_size);
+    decompressed->values.resize(chunk->compressed_size);
+    GorillaCodec<Timestamp, Value>::Decode(chunk->compressed.data(), chunk->compressed_size,
+        decompressed->timestamps.data(), decompressed->values.data());
+    return decompressed;
+}
+
+template<typename Timestamp, typename Value>
+typename TimeSeriesBuffer<Timestamp, Value>::ChunkPtr TimeSeriesBuffer<Timestamp, Value>::hotChunk(const ChunkPtr& chunk) const {
+    return decompressChunk(chunk);
+}
+
+// The cache lock is not held while decoding, so two readers may decode the same chunk; the later one wins
+template<typename Timestamp, typename Value>
+typename TimeSeriesBuffer<Timestamp, Value>::ChunkPtr TimeSeriesBuffer<Timestamp, Value>::cachedHotChunk(const ChunkPtr& chunk) const {
+    if (!chunk->isCompressed()) {
+        return chunk;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(decoded_cache_mutex_);
+        auto it = std::find_if(decoded_cache_.begin(), decoded_cache_.end(),
+            [&](const auto& entry) { return entry.first == chunk; });
+        if (it != decoded_cache_.end()) {
+            std::rotate(decoded_cache_.begin(), it, it + 1);
+            return decoded_cache_.front().second;
+        }
+    }
+
+    ChunkPtr decoded = decompressChunk(chunk);
+    std::lock_guard<std::mutex> lock(decoded_cache_mutex_);
+    auto it = std::find_if(decoded_cache_.begin(), decoded_cache_.end(),
+        [&](const auto& entry) { return entry.first == chunk; });
+    if (it != decoded_cache_.end()) {
+        decoded_cache_.erase(it);
+    } else if (decoded_cache_.size() >= DECODED_CACHE_CHUNKS) {
+        decoded_cache_.pop_back();
+    }
+    decoded_cache_.insert(decoded_cache_.begin(), {chunk, decoded});
+    return decoded;
+}
+
+template<typename Timestamp, typename Value>
+std::vector<typename TimeSeriesBuffer<Timestamp, Value>::ChunkPtr> TimeSeriesBuffer<Timestamp, Value>::makeChunks(
+    const std::vector<Timestamp>& timestamps, const std::vector<Value>& values) const {
+    std::vector<ChunkPtr> chunks;
+    chunks.reserve((timestamps.size() + chunk_capacity_ - 1) / chunk_capacity_);
+    for (std::size_t begin = 0; begin < timestamps.size(); begin += chunk_capacity_) {
+        std::size_t end = std::min(begin + chunk_capacity_, timestamps.size());
+        auto chunk = newChunk();
+        chunk->timestamps.assign(timestamps.begin() + begin, timestamps.begin() + end);
+        chunk->values.assign(values.begin() + begin, values.begin() + end);
+        chunks.push_back(std::move(chunk));
+    }
+    return chunks;
 }
 
+template class TimeSeriesRangeView<double, double>;
+template class TimeSeriesRangeView<std::int64_t, float>;
+template class TimeSeriesRangeView<std::int64_t, double>;
 template class TimeSeriesBuffer<double, double>;
+template class TimeSeriesBuffer<std::int64_t, float>;
+template class TimeSeriesBuffer<std::int64_t, double>;
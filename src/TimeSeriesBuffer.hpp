@@ -6,9 +6,18 @@
 #include <condition_variable>
 #include <functional>
 #include <map>
+#include <memory>
 #include <iterator>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <cmath>
+
+#include <memory_resource>
 
 #include "lttb.hpp"
+#include "gorilla.hpp"
+#include "MemoryResources.hpp"
 
 // For LTTB downsampling
 struct TimeSeriesPoint {
@@ -16,10 +25,113 @@ struct TimeSeriesPoint {
     double value;
 };
 
+// Immutable block of consecutive samples sorted by timestamp. Chunks are shared between the
+// buffer and any range views handed out, so they are never modified once published.
+// Cold chunks (outside the retained range) hold their samples Gorilla-compressed in `compressed`
+// instead, with timestamps and values left empty; range views only ever reference hot chunks.
+// All storage comes from the memory resource the chunk was created with.
+template<typename Timestamp, typename Value>
+struct TimeSeriesChunk {
+    explicit TimeSeriesChunk(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : timestamps(resource), values(resource), compressed(resource) {}
+
+    std::pmr::vector<Timestamp> timestamps;
+    std::pmr::vector<Value> values;
+
+    std::pmr::vector<std::uint64_t> compressed;
+    std::size_t compressed_size = 0;
+    Timestamp compressed_front{}, compressed_back{};
+
+    bool isCompressed() const { return !compressed.empty(); }
+    std::size_t size() const { return isCompressed() ? compressed_size : timestamps.size(); }
+    bool empty() const { return size() == 0; }
+    Timestamp front() const { return isCompressed() ? compressed_front : timestamps.front(); }
+    Timestamp back() const { return isCompressed() ? compressed_back : timestamps.back(); }
+};
+
+// Read-only view over a time range of a TimeSeriesBuffer. Holds references to the chunks it covers,
+// so it stays valid (and unchanged) after the buffer moves on, without copying any samples.
+template<typename Timestamp, typename Value>
+class TimeSeriesRangeView {
+public:
+    using Chunk = TimeSeriesChunk<Timestamp, Value>;
+    using ChunkPtr = std::shared_ptr<const Chunk>;
+
+    // Part of a chunk covered by the view: [begin, end)
+    struct Segment {
+        ChunkPtr chunk;
+        std::size_t begin;
+        std::size_t end;
+    };
+
+    // Forward iterator yielding (timestamp, value) pairs
+    class const_iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = std::pair<Timestamp, Value>;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = value_type;
+
+        const_iterator() = default;
+        const_iterator(const std::vector<Segment>* segments, std::size_t segment, std::size_t position)
+            : segments_(segments), segment_(segment), position_(position) {}
+
+        value_type operator*() const {
+            const Segment& segment = (*segments_)[segment_];
+            return {segment.chunk->timestamps[position_], segment.chunk->values[position_]};
+        }
+        const_iterator& operator++() {
+            if (++position_ >= (*segments_)[segment_].end) {
+                ++segment_;
+                position_ = segment_ < segments_->size() ? (*segments_)[segment_].begin : 0;
+            }
+            return *this;
+        }
+        const_iterator operator++(int) {
+            const_iterator previous = *this;
+            ++(*this);
+            return previous;
+        }
+        bool operator==(const const_iterator& other) const {
+            return segment_ == other.segment_ && position_ == other.position_;
+        }
+        bool operator!=(const const_iterator& other) const { return !(*this == other); }
+
+    private:
+        const std::vector<Segment>* segments_ = nullptr;
+        std::size_t segment_ = 0;
+        std::size_t position_ = 0;
+    };
+
+    TimeSeriesRangeView() = default;
+    explicit TimeSeriesRangeView(std::vector<Segment> segments);
+
+    std::size_t size() const;
+    bool empty() const;
+    const_iterator begin() const;
+    const_iterator end() const;
+    const std::vector<Segment>& getSegments() const { return segments_; }
+
+    // Sub-view covering [start, end], optionally extended by one sample on each side
+    TimeSeriesRangeView slice(Timestamp start, Timestamp end, bool include_neighbours = false) const;
+
+    // Materialize the view (copies the samples)
+    std::vector<std::pair<Timestamp, Value>> toVector() const;
+
+private:
+    std::vector<Segment> segments_; // Non-empty segments in time order
+};
+
 template<typename Timestamp, typename Value>
 class TimeSeriesBuffer {
 public:
-    TimeSeriesBuffer(double preload_factor = 0.2);
+    using Chunk = TimeSeriesChunk<Timestamp, Value>;
+    using ChunkPtr = std::shared_ptr<const Chunk>;
+    using RangeView = TimeSeriesRangeView<Timestamp, Value>;
+
+    // Chunks are allocated from `resource`, the shared time-series pool by default
+    TimeSeriesBuffer(double preload_factor = 0.2, std::pmr::memory_resource* resource = getTimeSeriesMemoryResource());
     ~TimeSeriesBuffer();
 
     // Delete copy semantics
@@ -30,25 +142,115 @@ public:
     TimeSeriesBuffer(TimeSeriesBuffer&& other) noexcept;
     TimeSeriesBuffer& operator=(TimeSeriesBuffer&& other) noexcept;
 
+    // Writers. Serialized on write_mutex_; each one publishes a new snapshot
     void initialize(const std::map<Timestamp, Value>& initial_data);
     void setRange(Timestamp start, Timestamp end, const std::function<void(Timestamp, Timestamp)>& preload_callback);
+    // Preload (and keep uncompressed) [preload_start, preload_end] instead of the symmetric preload_factor_ margin
+    void setRange(Timestamp start, Timestamp end, Timestamp preload_start, Timestamp preload_end,
+        const std::function<void(Timestamp, Timestamp)>& preload_callback);
     void addData(const std::vector<std::pair<Timestamp, Value>>& new_data);
-    std::vector<std::pair<Timestamp, Value>> getData();
-    std::map<Timestamp, Value> getDataMap() const;
+
+    // Stop the preload thread, waiting for a running preload to finish. Must not be called from the preload callback
+    void stopPreload();
+
+    // Readers. Never wait for writers; they work on the snapshot published last
+    std::vector<std::pair<Timestamp, Value>> getData() const; // Copies the whole buffer
+    std::map<Timestamp, Value> getDataMap() const; // Copies the whole buffer
+    RangeView getRange(Timestamp start, Timestamp end) const; // Zero-copy view of [start, end]. Cold chunks are decoded once and cached
+    std::size_t size() const;
+    std::uint64_t getVersion() const; // Increases every time the stored data changes
+    std::size_t getByteSize() const; // Approximate heap memory held by the published chunks
+
+    // Drop whole chunks, farthest from the current range first, until bytes_to_free bytes are released.
+    // With keep_retention_range, chunks overlapping the current range or its preload margins are kept, so
+    // nothing a preload of the range would load again is dropped. Returns the bytes released
+    std::size_t evict(std::size_t bytes_to_free, bool keep_retention_range);
 
 private:
+    // Immutable set of chunks published to readers. Replaced as a whole by writers (read-copy-update);
+    // old sets are reclaimed when the last reader or range view referencing them goes away
+    struct ChunkSet {
+        std::vector<ChunkPtr> chunks; // Sorted, non-overlapping chunks
+        std::size_t size = 0; // Total number of samples in chunks
+    };
+    using ChunkSetPtr = std::shared_ptr<const ChunkSet>;
+
+    std::pair<Timestamp, Timestamp> retentionRange() const;
+    void publish(std::shared_ptr<ChunkSet> chunk_set);
     void cleanup();
-    void enforceSizeLimit();
 
-    std::map<Timestamp, Value> data_;
-    int max_data_points_{655360}; // Takes 10MB of memory for double precision
+    // Steps of addData and cleanup. They edit a private copy of the chunk set with write_mutex_ held
+    bool appendData(ChunkSet& chunk_set, const std::vector<std::pair<Timestamp, Value>>& batch) const;
+    void mergeData(ChunkSet& chunk_set, const std::vector<std::pair<Timestamp, Value>>& batch) const;
+    bool updateCompression(ChunkSet& chunk_set) const;
+    void enforceSizeLimit(ChunkSet& chunk_set) const;
+
+    static std::size_t chunkByteSize(const Chunk& chunk);
+    std::shared_ptr<Chunk> newChunk() const; // Empty chunk (and its control block) allocated from resource_
+    ChunkPtr compressChunk(const ChunkPtr& chunk) const;
+    ChunkPtr decompressChunk(const ChunkPtr& chunk) const;
+    ChunkPtr hotChunk(const ChunkPtr& chunk) const; // The chunk itself, or a decompressed copy if cold
+    ChunkPtr cachedHotChunk(const ChunkPtr& chunk) const; // hotChunk, reusing copies decoded by earlier calls
+
+    // Split sorted samples into chunks of at most chunk_capacity_ samples
+    std::vector<ChunkPtr> makeChunks(const std::vector<Timestamp>& timestamps, const std::vector<Value>& values) const;
+
+    std::pmr::memory_resource* resource_;
+    std::atomic<ChunkSetPtr> snapshot_{std::make_shared<const ChunkSet>()};
+    std::size_t chunk_capacity_ = 4096;
+    int max_data_points_{655360}; // Uncompressed samples. Takes 10MB of memory for double precision
     Timestamp current_start_{}, current_end_{};
+    Timestamp preload_start_{}, preload_end_{}; // Contains the current range
     double preload_factor_;
-    std::mutex data_mutex_;
+    std::mutex write_mutex_;
+    std::atomic<std::uint64_t> version_{0};
+
+    // Chunks decoded for range views, most recently used first, so redrawing a plot over cold data does not
+    // decode the same chunks every frame. Each entry holds the cold chunk it was decoded from, so its address
+    // cannot be reused for another chunk. Costs up to DECODED_CACHE_CHUNKS uncompressed chunks per buffer,
+    // not counted by getByteSize(); evict() clears it
+    static constexpr std::size_t DECODED_CACHE_CHUNKS = 8;
+    mutable std::mutex decoded_cache_mutex_;
+    mutable std::vector<std::pair<ChunkPtr, ChunkPtr>> decoded_cache_; // Guarded by decoded_cache_mutex_
 
     std::function<void(Timestamp, Timestamp)> preload_callback_;
     std::thread background_thread_;
     std::mutex preload_mutex_;
     std::condition_variable preload_condition_;
-    bool stop_background_thread_;
+    bool preload_requested_ = false; // Guarded by preload_mutex_
+    std::atomic<bool> stop_background_thread_;
 };
+
+
+
+
+// ==================================================
+// Sensor sample types
+// ==================================================
+// Sensor timestamps are integer nanoseconds since the Unix epoch, exact at any date. Values are 32-bit
+// floats when built with TIME_SERIES_FLOAT_VALUES (halves their memory), doubles otherwise.
+// Timestamps are only converted to double seconds at the ImPlot boundary
+using SensorTimestamp = std::int64_t;
+#ifdef TIME_SERIES_FLOAT_VALUES
+using SensorValue = float;
+#else
+using SensorValue = double;
+#endif
+
+inline double timestampToSeconds(SensorTimestamp timestamp) {
+    // Split into whole and fractional seconds so the result is as precise as a double allows
+    return static_cast<double>(timestamp / 1000000000) + static_cast<double>(timestamp % 1000000000) * 1e-9;
+}
+
+inline SensorTimestamp secondsToTimestamp(double seconds) {
+    // Saturate instead of overflowing (e.g. fully zoomed out plots)
+    constexpr double limit = 9.2e9;
+    if (!(seconds > -limit)) {
+        return static_cast<SensorTimestamp>(-limit * 1e9);
+    }
+    if (!(seconds < limit)) {
+        return static_cast<SensorTimestamp>(limit * 1e9);
+    }
+    const double whole = std::floor(seconds);
+    return static_cast<SensorTimestamp>(whole) * 1000000000 + std::llround((seconds - whole) * 1e9);
+}
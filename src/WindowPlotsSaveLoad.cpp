@@ -40,6 +40,7 @@ nlohmann::json WindowPlotsSaveLoad::serialize(const RenderablePlot& renderablePl
     j["window_label"] = renderablePlot.getWindowLabel();
     j["plot_range"] = {renderablePlot.getPlotRange().first, renderablePlot.getPlotRange().second};
     j["real_time"] = renderablePlot.isRealTime();
+    j["plot_type"] = renderablePlot.getPlotType() == RenderablePlot::PlotType::Spectrogram ? "spectrogram" : "line";
 
     // Serialize Y axis labels
     nlohmann::json y_axis_labels_mappings;
@@ -164,6 +165,9 @@ RenderablePlot WindowPlotsSaveLoad::deserializeRenderablePlot(const nlohmann::js
     RenderablePlot plot(j.at("label").get<std::string>(), j.at("real_time").get<bool>());
     plot.setWindowLabel(j.at("window_label").get<std::string>());
     plot.setPlotRange(j.at("plot_range")[0].get<double>(), j.at("plot_range")[1].get<double>());
+    if (j.contains("plot_type") && j.at("plot_type").get<std::string>() == "spectrogram") { // Absent in older files
+        plot.setPlotType(RenderablePlot::PlotType::Spectrogram);
+    }
 
     // Deserialize Y axis labels
     for (const auto& [axis_str, label] : j.at("y_axis_labels").items()) {
@@ -202,7 +206,7 @@ RenderablePlot WindowPlotsSaveLoad::deserializeRenderablePlot(const nlohmann::js
             plot.addYAxisForSensor(sensor_label, im_axis);
 
             // Add sensors to data_ attribute
-            plot.setData(sensor_label, {});
+            plot.setData(sensor_label.get<std::string>(), {});
 
         }
 
@@ -0,0 +1,191 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <bit>
+#include <type_traits>
+
+// Gorilla compression (Pelkonen et al., "Gorilla: A Fast, Scalable, In-Memory Time Series Database").
+// Timestamps are stored as delta-of-deltas and values as the XOR with the previous value, both
+// with variable-length bit codes. Nearly regular timestamps cost ~1 bit and unchanged values 1 bit
+// per sample. Samples are handled as their raw bit patterns, so the round trip is lossless for
+// any 4 or 8 byte type (double and float as well as integer timestamps).
+template <typename TTimestamp, typename TValue>
+struct GorillaCodec {
+    static_assert(sizeof(TTimestamp) == 4 || sizeof(TTimestamp) == 8, "Timestamps must be 4 or 8 bytes");
+    static_assert(sizeof(TValue) == 4 || sizeof(TValue) == 8, "Values must be 4 or 8 bytes");
+
+    // Compress `count` samples into `words` (any vector-like container of std::uint64_t, e.g. a std::pmr::vector).
+    // The block does not store the count; keep it next to the block
+    template <typename Words>
+    static void Encode(const TTimestamp* timestamps, const TValue* values, std::size_t count, Words& words) {
+        words.clear();
+        if (count == 0) {
+            return;
+        }
+        BitWriter<Words> writer{words};
+
+        std::uint64_t previous_timestamp = ToBits(timestamps[0]);
+        std::uint64_t previous_value = ToBits(values[0]);
+        std::uint64_t previous_delta = 0;
+        int previous_leading = -1;
+        int previous_trailing = 0;
+        writer.write(previous_timestamp, 64);
+        writer.write(previous_value, 64);
+
+        for (std::size_t i = 1; i < count; ++i) {
+            // Timestamp: zigzag encoded delta-of-delta in a 0 / 7 / 9 / 12 / 64 bit bucket
+            const std::uint64_t timestamp = ToBits(timestamps[i]);
+            const std::uint64_t delta = timestamp - previous_timestamp;
+            const std::uint64_t zigzag = ZigZag(static_cast<std::int64_t>(delta - previous_delta));
+            if (zigzag == 0) {
+                writer.write(0b0, 1);
+            } else if (zigzag < (1ULL << 7)) {
+                writer.write(0b10, 2);
+                writer.write(zigzag, 7);
+            } else if (zigzag < (1ULL << 9)) {
+                writer.write(0b110, 3);
+                writer.write(zigzag, 9);
+            } else if (zigzag < (1ULL << 12)) {
+                writer.write(0b1110, 4);
+                writer.write(zigzag, 12);
+            } else {
+                writer.write(0b1111, 4);
+                writer.write(zigzag, 64);
+            }
+            previous_timestamp = timestamp;
+            previous_delta = delta;
+
+            // Value: XOR with the previous value. Reuse the previous meaningful bit window when it fits
+            const std::uint64_t value = ToBits(values[i]);
+            const std::uint64_t xored = value ^ previous_value;
+            previous_value = value;
+            if (xored == 0) {
+                writer.write(0b0, 1);
+                continue;
+            }
+            const int leading = std::countl_zero(xored);
+            const int trailing = std::countr_zero(xored);
+            if (previous_leading >= 0 && leading >= previous_leading && trailing >= previous_trailing) {
+                writer.write(0b10, 2);
+                writer.write(xored >> previous_trailing, 64 - previous_leading - previous_trailing);
+            } else {
+                const int meaningful = 64 - leading - trailing; // 1..64, stored as 0..63
+                writer.write(0b11, 2);
+                writer.write(static_cast<std::uint64_t>(leading), 6);
+                writer.write(static_cast<std::uint64_t>(meaningful - 1), 6);
+                writer.write(xored >> trailing, meaningful);
+                previous_leading = leading;
+                previous_trailing = trailing;
+            }
+        }
+        words.shrink_to_fit();
+    }
+
+    // Decompress `count` samples of `block` into the output arrays
+    static void Decode(const std::uint64_t* block, std::size_t count, TTimestamp* timestamps, TValue* values) {
+        if (count == 0) {
+            return;
+        }
+        BitReader reader{block};
+
+        std::uint64_t timestamp = reader.read(64);
+        std::uint64_t value = reader.read(64);
+        std::uint64_t delta = 0;
+        int leading = 0;
+        int trailing = 0;
+        timestamps[0] = FromBits<TTimestamp>(timestamp);
+        values[0] = FromBits<TValue>(value);
+
+        for (std::size_t i = 1; i < count; ++i) {
+            // Timestamp bucket: count the leading 1 bits (at most 4)
+            int prefix = 0;
+            while (prefix < 4 && reader.read(1)) {
+                ++prefix;
+            }
+            static constexpr int bucket_bits[] = {0, 7, 9, 12, 64};
+            if (prefix > 0) {
+                delta += static_cast<std::uint64_t>(UnZigZag(reader.read(bucket_bits[prefix])));
+            }
+            timestamp += delta;
+            timestamps[i] = FromBits<TTimestamp>(timestamp);
+
+            // Value
+            if (reader.read(1)) {
+                if (reader.read(1)) {
+                    leading = static_cast<int>(reader.read(6));
+                    const int meaningful = static_cast<int>(reader.read(6)) + 1;
+                    trailing = 64 - leading - meaningful;
+                }
+                value ^= reader.read(64 - leading - trailing) << trailing;
+            }
+            values[i] = FromBits<TValue>(value);
+        }
+    }
+
+private:
+    template <typename Words>
+    struct BitWriter {
+        Words& words;
+        int used = 64; // Bits used in words.back()
+
+        // Append the low `bits` bits of `data`, most significant first
+        void write(std::uint64_t data, int bits) {
+            if (bits < 64) {
+                data &= (1ULL << bits) - 1;
+            }
+            while (bits > 0) {
+                if (used == 64) {
+                    words.push_back(0);
+                    used = 0;
+                }
+                const int take = std::min(bits, 64 - used);
+                const std::uint64_t part = take == 64 ? data : (data >> (bits - take)) & ((1ULL << take) - 1);
+                words.back() |= part << (64 - used - take);
+                used += take;
+                bits -= take;
+            }
+        }
+    };
+
+    struct BitReader {
+        const std::uint64_t* words;
+        std::size_t position = 0; // In bits
+
+        std::uint64_t read(int bits) {
+            std::uint64_t result = 0;
+            while (bits > 0) {
+                const int offset = static_cast<int>(position & 63);
+                const int take = std::min(bits, 64 - offset);
+                const std::uint64_t word = words[position >> 6];
+                const std::uint64_t part = take == 64 ? word : (word >> (64 - offset - take)) & ((1ULL << take) - 1);
+                result = take == 64 ? part : (result << take) | part;
+                position += take;
+                bits -= take;
+            }
+            return result;
+        }
+    };
+
+    template <typename T>
+    using BitsOf = std::conditional_t<sizeof(T) == 8, std::uint64_t, std::uint32_t>;
+
+    template <typename T>
+    static std::uint64_t ToBits(T data) {
+        return static_cast<std::uint64_t>(std::bit_cast<BitsOf<T>>(data));
+    }
+
+    template <typename T>
+    static T FromBits(std::uint64_t bits) {
+        return std::bit_cast<T>(static_cast<BitsOf<T>>(bits));
+    }
+
+    static std::uint64_t ZigZag(std::int64_t data) {
+        return (static_cast<std::uint64_t>(data) << 1) ^ static_cast<std::uint64_t>(data >> 63);
+    }
+
+    static std::int64_t UnZigZag(std::uint64_t data) {
+        return static_cast<std::int64_t>(data >> 1) ^ -static_cast<std::int64_t>(data & 1);
+    }
+};
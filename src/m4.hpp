@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cstddef>
+#include <cmath>
+#include <algorithm>
+#include <array>
+
+// M4 aggregation (Jugel et al., "M4: A Visualization-Oriented Time Series Data Aggregation").
+// Every pixel column of the plot keeps at most four points: the first, minimum, maximum and
+// last sample that fall into the column. Drawing the reduced series as a line is pixel-identical
+// to drawing the raw data, so short spikes survive and the output is bounded by 4 * columns.
+template <typename TPoint, typename TX, typename TY, TX TPoint::*x, TY TPoint::*y>
+struct M4Aggregation {
+    // Accept every point
+    struct AcceptAll {
+        bool operator()(const TPoint&) const { return true; }
+    };
+
+    // Aggregate the sorted range [first, last) into `columns` pixel columns spanning [x_min, x_max].
+    // Only forward iteration is required, so chunked views can be aggregated without copying.
+    // Points outside [x_min, x_max] are passed through unchanged so lines extend to the plot edges.
+    // Points rejected by `filter` are skipped (e.g. non-positive values on a log axis).
+    template <typename InputIt, typename OutputIt, typename Filter = AcceptAll>
+    static void Downsample(InputIt first, InputIt last, double x_min, double x_max, std::size_t columns,
+                           OutputIt destination, Filter filter = Filter()) {
+        if (first == last || columns == 0 || !(x_max > x_min)) {
+            for (; first != last; ++first) {
+                if (filter(*first)) {
+                    *destination = *first;
+                    ++destination;
+                }
+            }
+            return;
+        }
+
+        const double column_width = (x_max - x_min) / static_cast<double>(columns);
+
+        // First, min, max and last point of the current column, tagged with their position in the input
+        struct Candidate {
+            std::size_t index;
+            TPoint point;
+        };
+        bool column_open = false;
+        long long current_column = 0;
+        Candidate first_point{}, min_point{}, max_point{}, last_point{};
+
+        auto flush = [&]() {
+            if (!column_open) {
+                return;
+            }
+            // Emit the four candidates in input order without duplicates
+            std::array<const Candidate*, 4> picks = {&first_point, &min_point, &max_point, &last_point};
+            std::sort(picks.begin(), picks.end(),
+                [](const Candidate* a, const Candidate* b) { return a->index < b->index; });
+            for (std::size_t i = 0; i < picks.size(); ++i) {
+                if (i > 0 && picks[i]->index == picks[i - 1]->index) {
+                    continue;
+                }
+                *destination = picks[i]->point;
+                ++destination;
+            }
+            column_open = false;
+        };
+
+        std::size_t index = 0;
+        for (InputIt it = first; it != last; ++it, ++index) {
+            const TPoint point = *it;
+            if (!filter(point)) {
+                continue;
+            }
+
+            const double px = static_cast<double>(point.*x);
+
+            // Pass through the neighbours outside the visible range
+            if (px < x_min || px > x_max) {
+                flush();
+                *destination = point;
+                ++destination;
+                continue;
+            }
+
+            long long column = static_cast<long long>(std::floor((px - x_min) / column_width));
+            column = std::clamp<long long>(column, 0, static_cast<long long>(columns) - 1);
+
+            if (!column_open || column != current_column) {
+                flush();
+                column_open = true;
+                current_column = column;
+                first_point = min_point = max_point = last_point = {index, point};
+                continue;
+            }
+
+            last_point = {index, point};
+            if (point.*y < min_point.point.*y) {
+                min_point = last_point;
+            }
+            if (point.*y > max_point.point.*y) {
+                max_point = last_point;
+            }
+        }
+        flush();
+    }
+};
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "SeriesFingerprint.hpp"
+
+// Set difference of sorted time series. Both inputs are walked once in step (a linear merge), so
+// nothing is copied or hashed. `key` and `other_key` return the sort key (the timestamp) of an element.
+// `emit` is called with the iterator of every element of [first, last) whose key is not in
+// [other_first, other_last), in order.
+template <typename InputIt, typename OtherIt, typename Key, typename OtherKey, typename Emit>
+void sortedDifference(InputIt first, InputIt last, OtherIt other_first, OtherIt other_last,
+                      Key key, OtherKey other_key, Emit emit) {
+    for (; first != last; ++first) {
+        const auto current = key(*first);
+        while (other_first != other_last && other_key(*other_first) < current) {
+            ++other_first;
+        }
+        if (other_first == other_last || current < other_key(*other_first)) {
+            emit(first);
+        }
+    }
+}
+
+// Summary of every fingerprint window the sorted range [first, last) touches, in window order
+template <typename InputIt, typename Key>
+SeriesFingerprint::Windows fingerprintWindows(InputIt first, InputIt last, Key key, const SeriesFingerprint& fingerprint) {
+    SeriesFingerprint::Windows windows;
+    for (; first != last; ++first) {
+        const double time = key(*first);
+        const std::int64_t window = fingerprint.getWindow(time);
+        if (windows.empty() || windows.back().index != window) {
+            windows.push_back({window});
+        }
+        windows.back().addTime(time);
+    }
+    return windows;
+}
+
+// Difference against a fingerprint: the samples of [first, last) in windows whose summary (count, first
+// and last time, hash of the times) differs from the one the fingerprint records for `stored` are emitted.
+// Windows are all-or-nothing, so any mismatch sends the whole window again (InfluxDB overwrites points
+// with the same series and time). `stored` may be nullptr when nothing of the sensor was uploaded
+template <typename InputIt, typename Key, typename Emit>
+void fingerprintDifference(InputIt first, InputIt last, Key key, const SeriesFingerprint& fingerprint,
+                           const SeriesFingerprint::Windows* stored, Emit emit) {
+    auto stored_it = stored ? stored->begin() : SeriesFingerprint::Windows::const_iterator{};
+    const auto stored_end = stored ? stored->end() : SeriesFingerprint::Windows::const_iterator{};
+
+    while (first != last) {
+        // Run of samples in the same window
+        SeriesFingerprint::Window current{fingerprint.getWindow(key(*first))};
+        InputIt run_end = first;
+        while (run_end != last && fingerprint.getWindow(key(*run_end)) == current.index) {
+            current.addTime(key(*run_end));
+            ++run_end;
+        }
+
+        while (stored_it != stored_end && stored_it->index < current.index) {
+            ++stored_it;
+        }
+        const bool uploaded = stored_it != stored_end && *stored_it == current;
+        for (; first != run_end; ++first) {
+            if (!uploaded) {
+                emit(first);
+            }
+        }
+    }
+}
+
+// Run function(i) for every i in [0, count). With parallel, the indices are handed out to one worker
+// per hardware thread; function must then be safe to run concurrently for different indices
+template <typename Function>
+void parallelFor(std::size_t count, bool parallel, Function function) {
+    const std::size_t workers = parallel ?
+        std::min<std::size_t>(count, std::max(1u, std::thread::hardware_concurrency())) : 1;
+    if (workers <= 1) {
+        for (std::size_t i = 0; i < count; ++i) {
+            function(i);
+        }
+        return;
+    }
+
+    std::atomic<std::size_t> next{0};
+    std::vector<std::thread> threads;
+    threads.reserve(workers);
+    for (std::size_t worker = 0; worker < workers; ++worker) {
+        threads.emplace_back([&next, &function, count]() {
+            for (std::size_t i = next++; i < count; i = next++) {
+                function(i);
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+}